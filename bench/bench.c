@@ -0,0 +1,486 @@
+// Microbenchmark runner: builds small synthetic ROMs in memory, runs each
+// for a fixed number of frames and reports emulated MHz, frames/s and
+// ns/instruction as JSON so runs can be compared across commits.
+//
+//   ./gba_bench [--frames N] [--json FILE] [--label TEXT] [name...]
+//
+// Console output from the core stays on stdout; the summary goes to stderr.
+
+#include "../include/apu.h"
+#include "../include/bios.h"
+#include "../include/common.h"
+#include "../include/cpu.h"
+#include "../include/dma.h"
+#include "../include/memory.h"
+#include "../include/ppu.h"
+#include "../include/scheduler.h"
+#include "../include/timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CYCLES_PER_FRAME 280896
+#define WARMUP_FRAMES 10
+
+// ---------------------------------------------------------------------------
+// ROM assembler: just enough ARM/Thumb encodings for the workloads
+
+#define ROM_BYTES 0x10000
+#define CODE_BASE 0x500
+#define CODE_END 0xD00
+#define DATA_BASE 0x4000
+
+static u8 rom[ROM_BYTES];
+static u32 rom_pos;
+
+#define AL 0xE0000000u
+#define NE 0x10000000u
+enum { AND = 0, EOR = 1, SUB = 2, ADD = 4, ORR = 12, MOV = 13 };
+enum { LSL = 0, LSR = 1 };
+
+static u32 here(void) { return 0x08000000 + rom_pos; }
+
+static void arm(u32 op) {
+  memcpy(&rom[rom_pos], &op, 4);
+  rom_pos += 4;
+}
+
+static void thumb(u16 op) {
+  memcpy(&rom[rom_pos], &op, 2);
+  rom_pos += 2;
+}
+
+static u32 dp_imm(u32 op, bool s, u32 rd, u32 rn, u32 imm8, u32 rot) {
+  return AL | 0x02000000 | op << 21 | (u32)s << 20 | rn << 16 | rd << 12 | rot << 8 | imm8;
+}
+
+static u32 dp_reg(u32 op, bool s, u32 rd, u32 rn, u32 rm, u32 shift, u32 amount) {
+  return AL | op << 21 | (u32)s << 20 | rn << 16 | rd << 12 | amount << 7 | shift << 5 | rm;
+}
+
+// LDR/STR with an immediate offset; post-indexed forms write back
+static u32 mem_imm(bool load, u32 rd, u32 rn, u32 offset, bool post) {
+  return AL | 0x04800000 | (post ? 0 : BIT(24)) | (load ? BIT(20) : 0) | rn << 16 | rd << 12 | offset;
+}
+
+static u32 strh_imm(u32 rd, u32 rn, u32 offset) {
+  return AL | 0x01C000B0 | rn << 16 | rd << 12 | (offset >> 4) << 8 | (offset & 0xF);
+}
+
+static u32 ldmia_wb(u32 rn, u32 list) { return AL | 0x08B00000 | rn << 16 | list; }
+static u32 stmia_wb(u32 rn, u32 list) { return AL | 0x08A00000 | rn << 16 | list; }
+
+static u32 branch(u32 cond, u32 target) {
+  return cond | 0x0A000000 | (((target - here() - 8) >> 2) & 0xFFFFFF);
+}
+
+static u16 thumb_branch(u32 target) { return 0xE000 | (((target - here() - 4) >> 1) & 0x7FF); }
+
+// MOV + ORR per non-zero byte
+static void arm_const(u32 rd, u32 value) {
+  bool first = true;
+  for (u32 shift = 0; shift < 32; shift += 8) {
+    u32 byte = (value >> shift) & 0xFF;
+    if (!byte && !(first && shift == 24)) continue;
+    arm(dp_imm(first ? MOV : ORR, false, rd, first ? 0 : rd, byte, ((32 - shift) & 31) / 2));
+    first = false;
+  }
+}
+
+// Store `words` words at dst, adding `step` to the value after each one
+// (clobbers r0-r3)
+static void emit_fill(u32 dst, u32 value, u32 step, u32 words) {
+  arm_const(0, dst);
+  arm_const(1, value);
+  arm_const(2, step);
+  arm_const(3, words);
+  u32 loop = here();
+  arm(mem_imm(false, 1, 0, 4, true));       // str r1, [r0], #4
+  arm(dp_reg(ADD, false, 1, 1, 2, LSL, 0)); // add r1, r1, r2
+  arm(dp_imm(SUB, true, 3, 3, 1, 0));       // subs r3, r3, #1
+  arm(branch(NE, loop));
+}
+
+static void emit_io16(u32 offset, u16 value) {
+  arm_const(0, 0x04000000);
+  arm_const(1, value);
+  arm(strh_imm(1, 0, offset));
+}
+
+// ALU-only loop body: r0 and r1 feed each other so nothing folds away
+static void emit_arm_alu_loop(void) {
+  arm_const(0, 0);
+  arm_const(1, 1);
+  u32 loop = here();
+  arm(dp_reg(ADD, false, 0, 0, 1, LSL, 0)); // add r0, r0, r1
+  arm(dp_reg(EOR, false, 2, 0, 1, LSL, 3)); // eor r2, r0, r1, lsl #3
+  arm(dp_reg(ORR, false, 3, 2, 0, LSR, 1)); // orr r3, r2, r0, lsr #1
+  arm(dp_imm(AND, false, 4, 3, 0xFF, 0));   // and r4, r3, #0xFF
+  arm(dp_reg(SUB, true, 1, 1, 4, LSL, 0));  // subs r1, r1, r4
+  arm(dp_imm(ADD, false, 1, 1, 1, 0));      // add r1, r1, #1
+  arm(branch(AL, loop));
+}
+
+// ---------------------------------------------------------------------------
+// Workloads
+
+static void build_arm_alu(void) { emit_arm_alu_loop(); }
+
+static void build_thumb_alu(void) {
+  arm(dp_imm(ADD, false, 0, 15, 1, 0)); // add r0, pc, #1 (Thumb code below)
+  arm(AL | 0x012FFF10);                 // bx r0
+  thumb(0x2000);                        // mov r0, #0
+  thumb(0x2101);                        // mov r1, #1
+  u32 loop = here();
+  thumb(0x1840); // add r0, r0, r1
+  thumb(0x00C2); // lsl r2, r0, #3
+  thumb(0x404A); // eor r2, r1
+  thumb(0x4302); // orr r2, r0
+  thumb(0x0853); // lsr r3, r2, #1
+  thumb(0x3101); // add r1, #1
+  thumb(0x400B); // and r3, r1
+  thumb(thumb_branch(loop));
+}
+
+// 16KB EWRAM -> EWRAM in 8-word LDM/STM bursts
+static void build_ldm_stm(void) {
+  u32 outer = here();
+  arm_const(0, 0x02000000);
+  arm_const(1, 0x02010000);
+  arm_const(10, 0x4000 / 32);
+  u32 loop = here();
+  arm(ldmia_wb(0, 0x3FC));              // ldmia r0!, {r2-r9}
+  arm(stmia_wb(1, 0x3FC));              // stmia r1!, {r2-r9}
+  arm(dp_imm(SUB, true, 10, 10, 1, 0)); // subs r10, r10, #1
+  arm(branch(NE, loop));
+  arm(branch(AL, outer));
+}
+
+// Straight-line ALU run, so the cost is dominated by opcode fetch
+static void emit_fetch_body(void) {
+  u32 loop = here();
+  for (int i = 0; i < 32; i++) arm(dp_reg(ADD, false, 0, 0, 1, LSL, 0));
+  arm(branch(AL, loop));
+}
+
+static void build_rom_fetch(void) {
+  arm_const(0, 0);
+  arm_const(1, 1);
+  emit_fetch_body();
+}
+
+// Copy the same body to IWRAM and run it there (branches are PC-relative)
+static void build_iwram_fetch(void) {
+  u32 body = 0x08000000 + CODE_BASE + 0x100;
+  arm_const(0, body);
+  arm_const(1, 0x03000000);
+  arm_const(2, 33);
+  u32 loop = here();
+  arm(mem_imm(true, 3, 0, 4, true));  // ldr r3, [r0], #4
+  arm(mem_imm(false, 3, 1, 4, true)); // str r3, [r1], #4
+  arm(dp_imm(SUB, true, 2, 2, 1, 0)); // subs r2, r2, #1
+  arm(branch(NE, loop));
+  arm_const(0, 0);
+  arm_const(1, 1);
+  arm_const(2, 0x03000000);
+  arm(AL | 0x012FFF12); // bx r2
+  rom_pos = body - 0x08000000;
+  emit_fetch_body();
+}
+
+// Back-to-back immediate 32KB DMA3 transfers in EWRAM
+static void build_dma_storm(void) {
+  arm_const(0, 0x040000D4);
+  arm_const(1, 0x02000000);
+  arm_const(2, 0x02020000);
+  arm_const(3, 0x84002000); // Enable, 32-bit, 0x2000 words
+  u32 loop = here();
+  arm(mem_imm(false, 1, 0, 0, false)); // DMA3SAD
+  arm(mem_imm(false, 2, 0, 4, false)); // DMA3DAD
+  arm(mem_imm(false, 3, 0, 8, false)); // DMA3CNT: starts at once
+  arm(branch(AL, loop));
+}
+
+// Four 4bpp text BGs with per-instruction scroll updates
+static void build_mode0_scroll(void) {
+  emit_fill(0x05000000, 0x04210000, 0x00420021, 128);  // BG palette
+  emit_fill(0x06000000, 0x12345678, 0x11111111, 0x800); // 256 tiles
+  emit_fill(0x06008000, 0x00010000, 0x00020002, 0x800); // Maps at SBB 16-19
+  for (int bg = 0; bg < 4; bg++) emit_io16(0x08 + bg * 2, (16 + bg) << 8 | bg);
+  emit_io16(0x00, 0x0F00); // Mode 0, BG0-3
+  arm_const(5, 0);
+  u32 loop = here();
+  arm(dp_imm(ADD, false, 5, 5, 1, 0)); // add r5, r5, #1
+  for (int bg = 0; bg < 4; bg++) {
+    arm(strh_imm(5, 0, 0x10 + bg * 4)); // BGxHOFS
+    arm(strh_imm(5, 0, 0x12 + bg * 4)); // BGxVOFS
+  }
+  arm(branch(AL, loop));
+}
+
+// 128 32x32 4bpp sprites spread over the screen
+static void build_sprites(void) {
+  emit_fill(0x05000200, 0x7C1F03E0, 0x00210021, 128);  // OBJ palette
+  emit_fill(0x06010000, 0x12345678, 0x11111111, 0x80); // 16 tiles
+  // OAM: attr0 = Y, attr1 = 32x32 | X; attr2 = tile 0
+  arm_const(0, 0x07000000);
+  arm_const(1, 0x80000000);
+  arm_const(2, 0x00050001);
+  arm_const(3, 128);
+  arm_const(4, 0);
+  u32 oam_loop = here();
+  arm(mem_imm(false, 1, 0, 4, true)); // str r1, [r0], #4
+  arm(mem_imm(false, 4, 0, 4, true)); // str r4, [r0], #4
+  arm(dp_reg(ADD, false, 1, 1, 2, LSL, 0));
+  arm(dp_imm(SUB, true, 3, 3, 1, 0));
+  arm(branch(NE, oam_loop));
+  emit_io16(0x00, 0x1040); // Mode 0, OBJ, 1D mapping
+  emit_arm_alu_loop();
+}
+
+// Full 240x160 bitmap rewritten with STM bursts, new colour each pass
+static void build_mode3_redraw(void) {
+  emit_io16(0x00, 0x0403);
+  arm_const(2, 0);
+  u32 outer = here();
+  arm(dp_imm(ADD, false, 2, 2, 0x21, 0)); // add r2, r2, #0x21
+  for (int r = 3; r <= 9; r++) arm(dp_reg(MOV, false, r, 0, 2, LSL, 0));
+  arm_const(0, 0x06000000);
+  arm_const(1, 240 * 160 * 2 / 32);
+  u32 loop = here();
+  arm(stmia_wb(0, 0x3FC));            // stmia r0!, {r2-r9}
+  arm(dp_imm(SUB, true, 1, 1, 1, 0)); // subs r1, r1, #1
+  arm(branch(NE, loop));
+  arm(branch(AL, outer));
+}
+
+// Greedy LZ77 in the BIOS format (type 0x10, 4KB window, 3-18 byte runs)
+static u32 lz77_compress(const u8 *src, u32 size, u8 *out) {
+  u32 o = 0;
+  out[o++] = 0x10;
+  out[o++] = size & 0xFF;
+  out[o++] = (size >> 8) & 0xFF;
+  out[o++] = (size >> 16) & 0xFF;
+  u32 i = 0;
+  while (i < size) {
+    u32 flag_pos = o++;
+    u8 flags = 0;
+    for (int bit = 7; bit >= 0 && i < size; bit--) {
+      u32 best_len = 0, best_disp = 0;
+      u32 window = i < 0x400 ? i : 0x400;
+      for (u32 disp = 1; disp <= window && best_len < 18; disp++) {
+        u32 len = 0;
+        while (len < 18 && i + len < size && src[i + len - disp] == src[i + len]) len++;
+        if (len > best_len) {
+          best_len = len;
+          best_disp = disp;
+        }
+      }
+      if (best_len >= 3) {
+        flags |= 1 << bit;
+        out[o++] = ((best_len - 3) << 4) | ((best_disp - 1) >> 8);
+        out[o++] = (best_disp - 1) & 0xFF;
+        i += best_len;
+      } else {
+        out[o++] = src[i++];
+      }
+    }
+    out[flag_pos] = flags;
+  }
+  while (o & 3) out[o++] = 0;
+  return o;
+}
+
+// LZ77UnCompWram of 8KB of tile-like data, over and over
+static void build_lz77(void) {
+  static u8 plain[0x2000];
+  u32 seed = 1;
+  for (u32 i = 0; i < sizeof(plain); i++) {
+    // Runs of repeated rows with occasional noise
+    seed = seed * 1103515245 + 12345;
+    plain[i] = ((i >> 5) % 7) * 0x11 + ((seed >> 28) == 0 ? (seed >> 16) & 0xFF : 0);
+  }
+  lz77_compress(plain, sizeof(plain), &rom[DATA_BASE]);
+
+  u32 loop = here();
+  arm_const(0, 0x08000000 + DATA_BASE);
+  arm_const(1, 0x02000000);
+  arm(AL | 0x0F110000); // swi 0x11
+  arm(branch(AL, loop));
+}
+
+typedef struct {
+  const char *name;
+  void (*build)(void);
+} Workload;
+
+static const Workload workloads[] = {
+    {"arm_alu", build_arm_alu},           {"thumb_alu", build_thumb_alu},
+    {"ldm_stm_memcpy", build_ldm_stm},    {"rom_fetch", build_rom_fetch},
+    {"iwram_fetch", build_iwram_fetch},   {"dma_storm", build_dma_storm},
+    {"mode0_4bg_scroll", build_mode0_scroll}, {"sprites_128", build_sprites},
+    {"mode3_redraw", build_mode3_redraw}, {"lz77_uncomp", build_lz77},
+};
+#define WORKLOAD_COUNT (sizeof(workloads) / sizeof(workloads[0]))
+
+static void build_rom(const Workload *w) {
+  memset(rom, 0, sizeof(rom));
+  rom_pos = 0;
+  arm(branch(AL, 0x08000000 + CODE_BASE));
+  rom_pos = CODE_BASE;
+  w->build();
+  if (rom_pos > CODE_END) {
+    fprintf(stderr, "%s: code overruns %08X\n", w->name, 0x08000000 + CODE_END);
+    exit(1);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Runner
+
+typedef struct {
+  u64 frames;
+  u64 cycles;
+  u64 instructions;
+  double seconds;
+} Result;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Same per-step order as the main loop
+static void run_frame(ARM7TDMI *cpu, Result *r) {
+  int cycles_run = 0;
+  while (cycles_run < CYCLES_PER_FRAME) {
+    bool halted = cpu->halted;
+    int cycles = cpu_step(cpu);
+    if (!halted) r->instructions++;
+    cycles += dma_take_cycles();
+    ppu_update(cycles);
+    scheduler_advance(cycles);
+    apu_step(cycles);
+    cycles_run += cycles;
+  }
+  ppu_update_texture(NULL);
+  r->cycles += cycles_run;
+  r->frames++;
+}
+
+static Result run_workload(const Workload *w, int frames) {
+  build_rom(w);
+  // The Zaffiro workarounds poke IWRAM/VRAM once per process: with them
+  // on, results would depend on which workload happens to run first
+  cpu_game_hacks = false;
+
+  ARM7TDMI cpu;
+  cpu_init(&cpu);
+  scheduler_init();
+  memory_init();
+  timer_init();
+  apu_init();
+  ppu_init(NULL, NULL);
+  memory_map_rom(rom, sizeof(rom));
+  cpu.r[REG_PC] = 0x08000000;
+  cpu.cpsr = 0x1F;
+  cpu.r[REG_SP] = 0x03007F00;
+  bios_init(&cpu);
+
+  Result r = {0};
+  for (int i = 0; i < WARMUP_FRAMES; i++) run_frame(&cpu, &r);
+  memset(&r, 0, sizeof(r));
+
+  double start = now_seconds();
+  for (int i = 0; i < frames; i++) run_frame(&cpu, &r);
+  r.seconds = now_seconds() - start;
+  return r;
+}
+
+static bool selected(const char *name, int argc, char **names) {
+  if (argc == 0) return true;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(names[i], name) == 0) return true;
+  }
+  return false;
+}
+
+static void print_usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [options] [benchmark...]\n", prog);
+  fprintf(stderr, "  --frames N     Frames measured per benchmark (default 300)\n");
+  fprintf(stderr, "  --json FILE    Write results as JSON (default: stderr summary only)\n");
+  fprintf(stderr, "  --label TEXT   Label stored in the JSON (e.g. a commit hash)\n");
+  fprintf(stderr, "Benchmarks:");
+  for (size_t i = 0; i < WORKLOAD_COUNT; i++) fprintf(stderr, " %s", workloads[i].name);
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+  int frames = 300;
+  const char *json_file = NULL;
+  const char *label = "";
+  char *names[WORKLOAD_COUNT];
+  int name_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_file = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+      label = argv[++i];
+    } else if (argv[i][0] == '-') {
+      print_usage(argv[0]);
+      return 1;
+    } else {
+      bool known = false;
+      for (size_t w = 0; w < WORKLOAD_COUNT; w++) known |= strcmp(argv[i], workloads[w].name) == 0;
+      if (!known || name_count == (int)WORKLOAD_COUNT) {
+        fprintf(stderr, "Unknown benchmark: %s\n", argv[i]);
+        print_usage(argv[0]);
+        return 1;
+      }
+      names[name_count++] = argv[i];
+    }
+  }
+  if (frames <= 0) frames = 1;
+
+  FILE *json = NULL;
+  if (json_file) {
+    json = fopen(json_file, "w");
+    if (!json) {
+      fprintf(stderr, "Failed to open %s\n", json_file);
+      return 1;
+    }
+    fprintf(json, "{\n  \"label\": \"%s\",\n  \"frames\": %d,\n  \"benchmarks\": [", label, frames);
+  }
+
+  bool first = true;
+  for (size_t i = 0; i < WORKLOAD_COUNT; i++) {
+    const Workload *w = &workloads[i];
+    if (!selected(w->name, name_count, names)) continue;
+
+    Result r = run_workload(w, frames);
+    double mhz = r.cycles / r.seconds / 1e6;
+    double fps = r.frames / r.seconds;
+    double ns_per_instr = r.instructions ? r.seconds * 1e9 / r.instructions : 0;
+    fprintf(stderr, "%-18s %9.2f MHz %9.1f fps %8.2f ns/instr\n", w->name, mhz, fps, ns_per_instr);
+
+    if (json) {
+      fprintf(json,
+              "%s\n    {\"name\": \"%s\", \"frames\": %llu, \"cycles\": %llu, \"instructions\": %llu, "
+              "\"seconds\": %.6f, \"emulated_mhz\": %.3f, \"fps\": %.2f, \"ns_per_instruction\": %.3f}",
+              first ? "" : ",", w->name, (unsigned long long)r.frames, (unsigned long long)r.cycles,
+              (unsigned long long)r.instructions, r.seconds, mhz, fps, ns_per_instr);
+    }
+    first = false;
+  }
+
+  if (json) {
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+  }
+  return 0;
+}
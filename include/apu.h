@@ -0,0 +1,45 @@
+#ifndef APU_H
+#define APU_H
+
+#include "common.h"
+
+// Audio Processing Unit
+// PSG channels 1-4 and Direct Sound FIFO A/B are mixed at the hardware
+// rate of 32768 Hz, then band-limited resampled to 48 kHz stereo into a
+// lock-free single-producer/single-consumer ring buffer.
+
+#define APU_OUTPUT_RATE 48000
+#define APU_MIX_RATE 32768
+#define APU_CYCLES_PER_MIX 512 // 16.78 MHz / 32768 Hz
+
+// FIFO register addresses (targets of sound DMA)
+#define APU_FIFO_A 0x040000A0
+#define APU_FIFO_B 0x040000A4
+
+void apu_init(void);
+
+// Advance the APU by CPU cycles (frame sequencer, channel timers, mixing)
+void apu_step(int cycles);
+
+// Register write side effects. Called after the raw store into io_regs.
+// offset is relative to 0x04000000; size is 1, 2 or 4 bytes.
+void apu_io_write(u32 offset, u32 value, int size);
+
+// Timer 0/1 overflow: FIFOs driven by this timer consume one sample and
+// request a DMA refill when half empty
+void apu_timer_overflow(int timer);
+
+// Push one 32-bit word into FIFO A (0) or B (1), as sound DMA does
+void apu_fifo_write32(int fifo, u32 value);
+
+// Consumer side of the ring buffer: reads up to `frames` stereo frames
+// (interleaved L/R) and returns how many were available
+int apu_read_samples(s16 *out, int frames);
+int apu_samples_available(void);
+
+// Headless output: stream the 48 kHz ring buffer into a WAV file
+bool apu_wav_open(const char *filename);
+void apu_wav_drain(void);
+void apu_wav_close(void);
+
+#endif // APU_H
@@ -0,0 +1,47 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include "common.h"
+
+// Cartridge Backup Memory
+// SRAM (32KB) and Flash (64/128KB) live at 0x0E000000 on the 8-bit bus;
+// EEPROM (512B/8KB) is a serial device at 0x0D000000 driven by DMA3.
+// The contents are an mmap of the .sav file, so writes persist without
+// explicit flushes.
+
+typedef enum {
+  BACKUP_NONE,
+  BACKUP_SRAM,
+  BACKUP_FLASH64,
+  BACKUP_FLASH128,
+  BACKUP_EEPROM,
+} BackupType;
+
+#define BACKUP_SRAM_SIZE 0x8000
+#define BACKUP_FLASH64_SIZE 0x10000
+#define BACKUP_FLASH128_SIZE 0x20000
+#define BACKUP_EEPROM_SIZE 0x2000
+
+// Scan the ROM for the library ID strings (SRAM_V, FLASH1M_V, EEPROM_V...)
+BackupType backup_detect(const u8 *rom, u32 size);
+const char *backup_type_name(BackupType type);
+
+// Map save_path (created and filled with 0xFF if missing). A NULL path
+// keeps the backup in anonymous memory.
+bool backup_init(BackupType type, const char *save_path);
+void backup_close(void);
+BackupType backup_type(void);
+
+// 0x0E000000 region (SRAM / Flash)
+u8 backup_read8(u32 addr);
+void backup_write8(u32 addr, u8 value);
+
+// EEPROM serial port: one bit per halfword access
+u16 backup_eeprom_read(void);
+void backup_eeprom_write(u16 value);
+
+// DMA3 transfer length to the EEPROM reveals the address width
+// (9/73 bits: 512B, 17/81 bits: 8KB)
+void backup_eeprom_hint(u32 count);
+
+#endif // BACKUP_H
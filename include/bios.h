@@ -6,4 +6,25 @@
 
 void bios_handle_swi(ARM7TDMI *cpu, u8 swi_number);
 
+// HLE boot: install the IRQ dispatch stub in the BIOS region and set the
+// stack pointers the BIOS leaves for IRQ, Supervisor and System mode
+void bios_init(ARM7TDMI *cpu);
+
+// LLE: a real 16KB BIOS image handles SWIs and IRQs
+#define BIOS_SIZE 0x4000
+extern bool bios_lle;
+bool bios_load_file(const char *path);
+
+// SWIs still served by HLE in LLE mode, bit n = SWI n. SoftReset (0x00),
+// Halt, Stop and the IntrWaits (0x02-0x05) always run the real code.
+#define BIOS_ACCEL_DEFAULT                                                   \
+    ((1ull << 0x06) | (1ull << 0x07) | (1ull << 0x0C) | (1ull << 0x11) |  \
+     (1ull << 0x12))
+void bios_set_accelerators(u64 mask);
+
+// Called on entry to the SWI vector (Supervisor mode, LR past the SWI):
+// runs an accelerated SWI and returns to the caller, otherwise leaves the
+// BIOS handler to run
+void bios_swi_entry(ARM7TDMI *cpu);
+
 #endif
@@ -0,0 +1,34 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "common.h"
+
+// Streaming video capture of every rendered frame.
+// Frames are handed to a background writer thread through a double buffer,
+// so the emulation thread only pays for one 150KB memcpy per frame.
+
+typedef enum {
+  CAPTURE_Y4M, // YUV4MPEG2, 4:2:0 BT.601 limited range (ffmpeg/mpv/x264 read it directly)
+  CAPTURE_RAW  // Raw RGBA8888, 240x160, no header
+} CaptureFormat;
+
+// Start capturing. filename "-" streams to stdout; console output is then
+// redirected to stderr so it can be piped straight into ffmpeg.
+bool capture_open(const char *filename, CaptureFormat format);
+
+// Queue one 240x160 ARGB8888 frame. Blocks only if the writer is more than
+// one frame behind (e.g. a stalled downstream pipe).
+void capture_frame(const u32 *framebuffer);
+
+// Flush queued frames, stop the writer thread and close the output
+void capture_close(void);
+
+bool capture_active(void);
+
+// Conversion kernels (exposed for tests). src is 240x160 ARGB8888;
+// y is 240x160, u and v are 120x80.
+void capture_rgb_to_yuv420(const u32 *src, u8 *y, u8 *u, u8 *v);
+void capture_rgb_to_yuv420_scalar(const u32 *src, u8 *y, u8 *u, u8 *v);
+void capture_argb_to_rgba(const u32 *src, u8 *dst, int pixels);
+
+#endif // CAPTURE_H
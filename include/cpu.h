@@ -3,6 +3,15 @@
 
 #include "common.h"
 
+// Lazy flags: flag-setting ALU ops record their operands and result
+// instead of computing NZCV; cpu_get_cpsr() materializes them on demand
+typedef enum {
+  FLAGS_CPSR,  // NZCV are current in cpsr
+  FLAGS_LOGIC, // N/Z from flag_res, C = flag_op1, V untouched in cpsr
+  FLAGS_ADD,   // flag_res = flag_op1 + flag_op2 + flag_cin
+  FLAGS_SUB    // flag_res = flag_op1 - flag_op2 - !flag_cin
+} FlagMode;
+
 // ARM7TDMI Registers
 // R0-R12: General purpose
 // R13: SP (Stack Pointer)
@@ -19,15 +28,55 @@ typedef struct {
   u32 r14_bank[6];
   u32 spsr_bank[6];
 
+  // Pending flag state (see FlagMode); NZCV in cpsr are stale unless
+  // flag_mode is FLAGS_CPSR
+  u32 flag_res;
+  u32 flag_op1;
+  u32 flag_op2;
+  u8 flag_cin;
+  u8 flag_mode;
+
   // Pipeline simulation or internal state could go here
   bool pipeline_flushed;
-  bool halted; // Halt state (SWI 0x05 / 0x02)
+  bool halted;  // Halt state (SWI 0x02 / 0x04 / 0x05, HALTCNT)
+  bool stopped; // Stop state (SWI 0x03): only keypad/serial/GamePak IRQs wake
 } ARM7TDMI;
 
 // Function prototypes
 void cpu_init(ARM7TDMI *cpu);
 int cpu_step(ARM7TDMI *cpu);
 
+// Condition codes: bit `cond` of cpu_cond_table[NZCV] is set when the
+// condition passes, so a check is one load and a bit test
+extern const u16 cpu_cond_table[16];
+
+static inline bool cpu_check_condition(u32 cond, u32 cpsr) {
+  return (cpu_cond_table[cpsr >> 28] >> cond) & 1;
+}
+
+// CPSR with NZCV materialized (MRS, exception entry, debugging)
+u32 cpu_get_cpsr(ARM7TDMI *cpu);
+// Replace CPSR wholesale, banking registers for the new mode and discarding
+// pending flags (MSR, exception return)
+void cpu_set_cpsr(ARM7TDMI *cpu, u32 value);
+
+// Enter a processor mode, swapping in its banked R13/R14/SPSR
+void cpu_switch_mode(ARM7TDMI *cpu, u32 new_mode);
+
+#ifdef GBA_STATS
+// Name of the handler behind an ARM/Thumb dispatch table slot
+const char *cpu_arm_handler_name(u32 index);
+const char *cpu_thumb_handler_name(u32 index);
+#endif
+
+// Zaffiro ROM workarounds in cpu_step (on by default). They patch memory
+// and registers at fixed addresses, so other guest code turns them off.
+extern bool cpu_game_hacks;
+
+// Run the current instruction again once the step ends (HLE BIOS waits
+// re-check their condition after each wake-up)
+void cpu_repeat_instruction(ARM7TDMI *cpu);
+
 // Helper to access named registers more easily
 #define REG_SP 13
 #define REG_LR 14
@@ -0,0 +1,27 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include "common.h"
+
+// DMA Channels 0-3
+// Source/destination/count are latched into internal registers when a
+// channel is enabled. Transfers between plain memory regions run as bulk
+// memcpy/fill; only IO destinations go element by element through the bus.
+
+void dma_init(void);
+
+// DMAxCNT_H write (after the raw store into io_regs)
+void dma_write_control(int channel, u16 control_val);
+
+// Start timings
+void dma_on_vblank(void);
+void dma_on_hblank(void);
+void dma_on_video_capture(int vcount); // DMA3 special timing, lines 2-161
+
+// Direct Sound FIFO at fifo_addr is half empty: run DMA1/2 if armed for it
+void dma_sound_request(u32 fifo_addr);
+
+// Cycles the CPU was stalled by transfers since the last call
+int dma_take_cycles(void);
+
+#endif // DMA_H
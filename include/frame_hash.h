@@ -0,0 +1,30 @@
+#ifndef FRAME_HASH_H
+#define FRAME_HASH_H
+
+#include "common.h"
+#include <stddef.h>
+
+// 64-bit XXH3 (default secret, seed 0). Bit-exact with XXH3_64bits().
+u64 frame_hash_xxh3(const void *data, size_t len);
+
+// Golden file: one "<frame> <hash>" pair per line, hash in hex.
+// Blank lines and lines starting with '#' are ignored.
+typedef struct {
+  u32 *frames; // Sorted ascending
+  u64 *hashes;
+  int count;
+  int capacity;
+} GoldenSet;
+
+void golden_init(GoldenSet *set);
+void golden_free(GoldenSet *set);
+bool golden_load(GoldenSet *set, const char *filename);
+bool golden_save(const GoldenSet *set, const char *filename);
+
+// Insert or replace the expected hash for a frame
+void golden_set(GoldenSet *set, u32 frame, u64 hash);
+
+// Returns false if the set has no entry for this frame
+bool golden_lookup(const GoldenSet *set, u32 frame, u64 *hash);
+
+#endif // FRAME_HASH_H
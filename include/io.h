@@ -0,0 +1,36 @@
+#ifndef IO_H
+#define IO_H
+
+#include "common.h"
+
+// IO Register Dispatch (0x04000000 - 0x040003FF)
+// One read handler, write handler and write mask per halfword register.
+// 8-bit accesses reach the handler with a byte lane mask, 32-bit accesses
+// as two halfword writes (low half first).
+
+// Write handlers receive the halfword-aligned offset, the value shifted
+// into place and the mask of bits the CPU actually wrote
+typedef u16 (*IoReadHandler)(u32 offset);
+typedef void (*IoWriteHandler)(u32 offset, u16 value, u16 mask);
+
+void io_init(void);
+
+u8 io_read8(u32 offset);
+u16 io_read16(u32 offset);
+u32 io_read32(u32 offset);
+void io_write8(u32 offset, u8 value);
+void io_write16(u32 offset, u16 value);
+void io_write32(u32 offset, u32 value);
+
+// HALTCNT was written since the last call: 1 = Halt, 2 = Stop, 0 = none
+int io_take_halt_request(void);
+
+// Interrupt controller state, recomputed whenever IE, IF or IME changes:
+// the enabled requests (IE & IF) and the IME master enable
+extern u16 io_irq_pending;
+extern bool io_irq_master;
+
+// Raise interrupt request bits in IF (devices call this, not raw stores)
+void io_request_irq(u16 mask);
+
+#endif // IO_H
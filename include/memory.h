@@ -3,6 +3,8 @@
 
 #include "common.h"
 
+#define ROM_MAX 0x02000000 // 32MB GamePak address space
+
 // Initialize memory subsystem
 void memory_init(void);
 
@@ -11,6 +13,9 @@ u8 mmu_read8(u32 addr);
 u16 mmu_read16(u32 addr);
 extern u8 *rom_memory; // Buffer globale per la ROM
 bool memory_load_rom(const char *filename);
+// Copy a ROM image into the GamePak space (NULL unmaps it)
+bool memory_map_rom(const u8 *data, u32 size);
+u32 memory_rom_size(void);
 
 u8 bus_read8(u32 addr);
 u16 bus_read16(u32 addr);
@@ -19,14 +24,48 @@ void bus_write8(u32 addr, u8 value);
 void bus_write16(u32 addr, u16 value);
 void bus_write32(u32 addr, u32 value);
 
+// CPU loads with ARMv4T misaligned-address semantics (LDR, LDRH, LDRSH)
+u32 bus_load32(u32 addr);
+u32 bus_load16(u32 addr);
+u32 bus_load16s(u32 addr);
+
 u8 *memory_get_vram(void);
 u8 *memory_get_io(void);
 u8 *memory_get_pal(void);
 u8 *memory_get_oam(void);
 u32 bus_read32(u32 addr);
 void memory_set_key_state(u16 key_mask);
-void memory_check_dma_vblank(void);
-void timer_step(int cycles);
+
+// Copy a BIOS image (or HLE stubs) to the start of the BIOS region
+void memory_load_bios(const u8 *data, u32 size);
+
+// Host pointer to [addr, addr + len) inside one plain memory region, or
+// NULL (IO, unmapped, region crossing; BIOS/ROM when write is set)
+u8 *memory_region_ptr(u32 addr, u32 len, bool write);
+// Same, for streams of unknown length: *avail receives the bytes left in
+// the region
+u8 *memory_region_span(u32 addr, bool write, u32 *avail);
+
+// Bus cost of a block transfer done through memory_region_ptr
+void memory_charge_block(u32 addr, int words);
+
+// Rebuild the access cost table from WAITCNT
+void memory_update_waitstates(void);
+
+// Bus cycles of a single access (N when !sequential, S otherwise),
+// from the WAITCNT-driven region table
+int memory_access_cycles(u32 addr, bool is_32, bool sequential);
+
+// Cycles charged by bus accesses; the CPU clears it before each
+// instruction and adds it to the instruction's cost
+extern int bus_cycles;
+
+// Opcode fetches (GamePak prefetch buffer aware)
+u32 bus_fetch32(u32 addr);
+u16 bus_fetch16(u32 addr);
+
+// Internal CPU cycles with the bus idle (lets the prefetcher run ahead)
+void memory_idle(int cycles);
 
 void mmu_write8(u32 addr, u8 value);
 void mmu_write16(u32 addr, u16 value);
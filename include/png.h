@@ -0,0 +1,37 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include "common.h"
+#include <stddef.h>
+
+// Minimal PNG encoder (8-bit RGB, no external dependencies)
+
+#define PNG_LEVEL_STORED 0 // Uncompressed deflate blocks
+#define PNG_LEVEL_FAST 1   // Greedy LZ77 + fixed Huffman
+
+// Encode ARGB8888 pixels into a malloc'd PNG file image. Returns its size,
+// or 0 on allocation failure.
+size_t png_encode(const u32 *argb, int width, int height, int level, u8 **out);
+
+// Encode and write with a single fwrite
+bool png_write(const char *filename, const u32 *argb, int width, int height);
+
+// Copy the pixels and encode/write on a background thread
+bool png_write_async(const char *filename, const u32 *argb, int width, int height);
+
+// Wait for all queued asynchronous writes
+void png_async_flush(void);
+
+// Raw deflate stream (greedy LZ77 + fixed Huffman, no zlib header) in a
+// malloc'd buffer. Returns its size, or 0 on allocation failure.
+size_t png_deflate(const u8 *data, size_t len, u8 **out);
+
+// Inverse of png_deflate (stored and fixed-Huffman blocks only). Returns
+// the decompressed size, or (size_t)-1 on corrupt input or overflow.
+size_t png_inflate(const u8 *data, size_t len, u8 *out, size_t out_len);
+
+// Checksums used by the encoder (exposed for tests)
+u32 png_crc32(u32 crc, const u8 *data, size_t len);
+u32 png_adler32(u32 adler, const u8 *data, size_t len);
+
+#endif // PNG_H
@@ -25,13 +25,28 @@ void ppu_step(void);
 // Update PPU state based on CPU cycles
 void ppu_update(int cycles);
 
+// Cycles until the next HBlank or scanline edge (how far a halted CPU may
+// skip without missing a PPU interrupt)
+int ppu_cycles_until_event(void);
+
 // Update texture with frame buffer
 void ppu_update_texture(SDL_Texture *texture);
 
 // Render one scanline in Mode 0 (Headless/Test)
 void ppu_render_scanline_mode0(u32 *scanline_buffer, int line);
 
-// Save screenshot to PPM file (Headless Debug)
+// Save screenshot of the last frame. Format follows the extension:
+// ".png" writes PNG, anything else binary PPM.
 void ppu_save_screenshot(const char *filename);
 
+// Same, but PNG compression and file IO run on a background thread.
+// Call png_async_flush() before exiting.
+void ppu_save_screenshot_async(const char *filename);
+
+// Last rendered frame (240x160 ARGB8888)
+const u32 *ppu_get_framebuffer(void);
+
+// XXH3-64 of the last rendered frame, for golden-image regression checks
+u64 ppu_frame_hash(void);
+
 #endif // PPU_H
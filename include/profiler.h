@@ -0,0 +1,35 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common.h"
+#include "cpu.h"
+
+// Guest sampling profiler: every `interval` emulated cycles the PC and a
+// shadow call stack are recorded; the result is written as folded stacks
+// ("main;update;draw 42") for flamegraph.pl / speedscope.
+
+extern bool profiler_enabled;
+
+void profiler_init(u32 interval);
+void profiler_reset(void);
+
+// Optional symbols: ELF (.elf symtab FUNC entries) or a text map with
+// "address name" / nm-style "address T name" lines (GNU ld .map works)
+bool profiler_load_symbols(const char *path);
+// Symbol containing addr, or NULL
+const char *profiler_symbol(u32 addr);
+
+// After a step that flushed the pipeline: `from` is the branching opcode.
+// A target matching a shadow frame's return address pops to it; a branch
+// that leaves LR pointing just past itself (BL, MOV LR, PC + BX) is a call.
+void profiler_branch(ARM7TDMI *cpu, u32 from);
+// Exception entry: a call that returns to `ret`
+void profiler_exception(u32 vector, u32 ret);
+
+// Main loop hook: account `cycles` and take any samples that fall due
+void profiler_sample(ARM7TDMI *cpu, int cycles);
+
+// Folded stacks to `path`; the hottest PCs go to stdout
+bool profiler_write(const char *path);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+
+// Absolute-cycle event scheduler
+// Each event kind has at most one pending occurrence. Components schedule
+// an event at an absolute cycle; scheduler_advance() fires every event whose
+// time has been reached, in time order.
+
+typedef enum {
+  SCHED_TIMER0,
+  SCHED_TIMER1,
+  SCHED_TIMER2,
+  SCHED_TIMER3,
+  SCHED_EVENT_COUNT
+} SchedEvent;
+
+#define SCHED_NEVER UINT64_MAX
+
+// Callback receives the cycle the event was scheduled for (<= now)
+typedef void (*SchedCallback)(SchedEvent event, u64 when);
+
+void scheduler_init(void);
+void scheduler_register(SchedEvent event, SchedCallback callback);
+
+// Current absolute cycle count
+u64 scheduler_now(void);
+
+void scheduler_schedule(SchedEvent event, u64 when);
+void scheduler_cancel(SchedEvent event);
+
+// Cycle of the earliest pending event (SCHED_NEVER if none)
+u64 scheduler_next_event(void);
+
+// Advance time and fire due events
+void scheduler_advance(int cycles);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+
+// Hot-path counters, compiled in with -DGBA_STATS (make STATS=1). Without
+// it every hook below expands to nothing.
+
+typedef enum {
+  STATS_PPU_BACKGROUND, // Mode 0 text layers
+  STATS_PPU_OBJECTS,    // Sprites
+  STATS_PPU_BITMAP,     // Modes 3/4
+  STATS_PPU_PRESENT,    // Texture upload
+  STATS_PPU_STAGES
+} StatsPpuStage;
+
+#ifdef GBA_STATS
+
+typedef struct {
+  u64 arm_ops[4096];  // By ARM dispatch index (condition passed)
+  u64 thumb_ops[1024]; // By Thumb dispatch index
+  u64 bus[256][3];    // Billed accesses by address bits 31-24, 8/16/32-bit
+  u64 halted_cycles;
+  u64 dma_bytes[4];
+  u64 swi[256];
+  u64 ppu_ns[STATS_PPU_STAGES];
+} Stats;
+
+// Per thread, so batch runs on several threads never share a cache line
+extern _Thread_local Stats gba_stats;
+
+#define STATS_INC(field) (gba_stats.field++)
+#define STATS_ADD(field, n) (gba_stats.field += (n))
+#define STATS_TIME_BEGIN(var) u64 var = stats_now_ns()
+#define STATS_TIME_END(var, stage) (gba_stats.ppu_ns[stage] += stats_now_ns() - (var))
+
+u64 stats_now_ns(void);
+void stats_reset(void);
+// JSON snapshot of the calling thread's counters
+bool stats_write_json(const char *path);
+// Write to `path` at exit and whenever SIGUSR1 arrives (via stats_poll)
+void stats_install(const char *path);
+// Services a pending SIGUSR1 dump; call once per frame
+void stats_poll(void);
+
+#else
+
+#define STATS_INC(field) ((void)0)
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_TIME_BEGIN(var)
+#define STATS_TIME_END(var, stage) ((void)0)
+
+static inline void stats_install(const char *path) { (void)path; }
+static inline void stats_poll(void) {}
+
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "common.h"
+
+// Timers 0-3
+// A running timer is kept as (start cycle, counter at start, prescaler);
+// TMxCNT_L reads compute the counter from the current cycle, and overflows
+// are absolute-cycle scheduler events. Count-up timers are incremented
+// directly by the overflow of the previous timer.
+
+void timer_init(void);
+
+// Current counter value of a timer (TMxCNT_L read)
+u16 timer_read_counter(int timer);
+
+// Register write side effects for TM0CNT_L..TM3CNT_H. Called after the raw
+// store into io_regs; offset is relative to 0x04000000.
+void timer_io_write(u32 offset, int size);
+
+#endif // TIMER_H
@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+#include "cpu.h"
+#include <stdio.h>
+
+// Binary execution trace: one fixed-size record per instruction, filled on
+// the emulation thread into a ring of chunks and compressed to disk by a
+// background writer. gba_trace filters and renders the file as text.
+
+typedef enum {
+  TRACE_EXEC, // An instruction ran
+  TRACE_IRQ,  // IRQ entry: pc is the vector, opcode the interrupted PC
+  TRACE_HALT, // Halted: pc is the resume PC, opcode the cycles skipped
+  TRACE_EVENTS
+} TraceEvent;
+
+// TraceRecord.flags: data access width in bytes (0 = none), its
+// direction, and the instruction set the opcode belongs to
+#define TRACE_MEM_SIZE 0x07
+#define TRACE_MEM_WRITE 0x08
+#define TRACE_THUMB 0x10
+
+typedef struct {
+  u64 cycle;     // Scheduler time when the instruction started
+  u32 pc;
+  u32 opcode;    // 16-bit in Thumb state
+  u32 cpsr;      // After the instruction, NZCV materialized
+  u32 r[16];     // After the instruction
+  u32 mem_addr;  // First data access of the instruction
+  u32 mem_value;
+  u16 changed;   // Registers that differ from the previous record
+  u8 type;       // TraceEvent
+  u8 flags;
+} TraceRecord;
+
+extern bool trace_enabled;
+
+// Start tracing the calling thread's CPU to `path` / stop and flush it
+bool trace_open(const char *path);
+void trace_close(void);
+
+// cpu_step hooks: begin captures the PC and opcode, the data access hook
+// keeps the first load/store, end snapshots the registers and emits
+void trace_begin(ARM7TDMI *cpu);
+void trace_mem(u32 addr, u32 value, u32 flags);
+void trace_end(ARM7TDMI *cpu);
+// Non-instruction records (TRACE_IRQ, TRACE_HALT)
+void trace_event(ARM7TDMI *cpu, TraceEvent type, u32 pc, u32 arg);
+
+// Reading a trace file back
+typedef struct TraceReader TraceReader;
+
+TraceReader *trace_reader_open(const char *path);
+// Next record in file order; false at end of file or on a corrupt block
+bool trace_reader_next(TraceReader *reader, TraceRecord *rec);
+void trace_reader_close(TraceReader *reader);
+
+// One line of text: cycle, event, PC, opcode, changed registers, access
+void trace_format(const TraceRecord *rec, FILE *out);
+
+#endif
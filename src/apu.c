@@ -0,0 +1,659 @@
+#include "../include/apu.h"
+#include "../include/dma.h"
+#include "../include/memory.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// Sound register offsets (relative to 0x04000000)
+#define SOUND1CNT_L 0x60
+#define SOUND1CNT_H 0x62
+#define SOUND1CNT_X 0x64
+#define SOUND2CNT_L 0x68
+#define SOUND2CNT_H 0x6C
+#define SOUND3CNT_L 0x70
+#define SOUND3CNT_H 0x72
+#define SOUND3CNT_X 0x74
+#define SOUND4CNT_L 0x78
+#define SOUND4CNT_H 0x7C
+#define SOUNDCNT_L 0x80
+#define SOUNDCNT_H 0x82
+#define SOUNDCNT_X 0x84
+#define SOUNDBIAS 0x88
+#define WAVE_RAM 0x90
+#define FIFO_A_OFS 0xA0
+#define FIFO_B_OFS 0xA4
+
+#define FRAME_SEQ_CYCLES 32768 // 512 Hz
+
+static inline u16 reg16(u32 offset) { return *(u16 *)&memory_get_io()[offset]; }
+
+// PSG State
+
+typedef struct {
+  bool enabled;
+  int timer;    // Cycles until the next waveform step
+  int position; // Duty step (square), sample index (wave)
+  int length;
+  int volume;
+  int env_timer;
+  // Channel 1 sweep
+  int sweep_timer;
+  bool sweep_enabled;
+  int shadow_freq;
+  // Channel 4
+  u16 lfsr;
+  bool noise_high;
+} PsgChannel;
+
+static PsgChannel psg[4];
+static u8 wave_ram[2][16];
+static int frame_seq_timer;
+static int frame_seq_step;
+
+static const u8 duty_table[4][8] = {
+    {0, 0, 0, 0, 0, 0, 0, 1}, // 12.5%
+    {1, 0, 0, 0, 0, 0, 0, 1}, // 25%
+    {1, 0, 0, 0, 0, 1, 1, 1}, // 50%
+    {0, 1, 1, 1, 1, 1, 1, 0}, // 75%
+};
+
+// Direct Sound State
+
+typedef struct {
+  s8 data[32];
+  int read, count;
+  s8 sample; // Currently playing
+} SoundFifo;
+
+static SoundFifo fifo[2];
+
+static int mix_timer;
+
+// Channel Helpers
+
+static int square_period(u16 cnt_x) { return 16 * (2048 - (cnt_x & 0x7FF)); }
+static int wave_period(u16 cnt_x) { return 8 * (2048 - (cnt_x & 0x7FF)); }
+
+static int noise_period(u16 cnt_h) {
+  int r = cnt_h & 7;
+  int s = (cnt_h >> 4) & 0xF;
+  return (r ? r * 32 : 16) << (s + 1);
+}
+
+// Advance a channel timer; returns how many periods elapsed
+static inline int advance_timer(int *timer, int period, int cycles) {
+  *timer -= cycles;
+  if (*timer > 0) return 0;
+  int steps = 1 + (-*timer) / period;
+  *timer += steps * period;
+  return steps;
+}
+
+// Envelope DAC is powered when initial volume or direction is non-zero
+static bool envelope_dac_on(u16 env_reg) { return (env_reg & 0xF800) != 0; }
+
+static int sweep_calculate(void) {
+  u16 sweep = reg16(SOUND1CNT_L);
+  int shift = sweep & 7;
+  int delta = psg[0].shadow_freq >> shift;
+  int freq = (sweep & 0x08) ? psg[0].shadow_freq - delta : psg[0].shadow_freq + delta;
+  if (freq > 2047) psg[0].enabled = false;
+  return freq;
+}
+
+static void update_status(void) {
+  u8 *io = memory_get_io();
+  u8 status = io[SOUNDCNT_X] & 0x80;
+  for (int i = 0; i < 4; i++) {
+    if (psg[i].enabled) status |= 1 << i;
+  }
+  io[SOUNDCNT_X] = status;
+}
+
+static void trigger_channel(int ch) {
+  PsgChannel *c = &psg[ch];
+  u16 env_reg = 0;
+  int max_length = 64;
+
+  switch (ch) {
+  case 0:
+    env_reg = reg16(SOUND1CNT_H);
+    c->timer = square_period(reg16(SOUND1CNT_X));
+    break;
+  case 1:
+    env_reg = reg16(SOUND2CNT_L);
+    c->timer = square_period(reg16(SOUND2CNT_H));
+    break;
+  case 2:
+    max_length = 256;
+    c->timer = wave_period(reg16(SOUND3CNT_X));
+    c->position = 0;
+    break;
+  case 3:
+    env_reg = reg16(SOUND4CNT_L);
+    c->timer = noise_period(reg16(SOUND4CNT_H));
+    c->lfsr = (reg16(SOUND4CNT_H) & 0x08) ? 0x40 : 0x4000;
+    break;
+  }
+
+  c->enabled = true;
+  if (c->length == 0) c->length = max_length;
+  if (ch != 2) {
+    c->volume = env_reg >> 12;
+    c->env_timer = (env_reg >> 8) & 7;
+    if (!envelope_dac_on(env_reg)) c->enabled = false;
+  } else if (!(memory_get_io()[SOUND3CNT_L] & 0x80)) {
+    c->enabled = false;
+  }
+
+  if (ch == 0) {
+    u16 sweep = reg16(SOUND1CNT_L);
+    int period = (sweep >> 4) & 7;
+    c->shadow_freq = reg16(SOUND1CNT_X) & 0x7FF;
+    c->sweep_timer = period ? period : 8;
+    c->sweep_enabled = period || (sweep & 7);
+    if (sweep & 7) sweep_calculate();
+  }
+}
+
+// Frame Sequencer (512 Hz): length 256 Hz, sweep 128 Hz, envelope 64 Hz
+
+static void clock_length(void) {
+  static const u32 length_enable_reg[4] = {SOUND1CNT_X, SOUND2CNT_H, SOUND3CNT_X, SOUND4CNT_H};
+  for (int i = 0; i < 4; i++) {
+    if (!(reg16(length_enable_reg[i]) & 0x4000) || psg[i].length == 0) continue;
+    if (--psg[i].length == 0) psg[i].enabled = false;
+  }
+}
+
+static void clock_sweep(void) {
+  PsgChannel *c = &psg[0];
+  if (--c->sweep_timer > 0) return;
+  u16 sweep = reg16(SOUND1CNT_L);
+  int period = (sweep >> 4) & 7;
+  c->sweep_timer = period ? period : 8;
+  if (!c->sweep_enabled || period == 0) return;
+
+  int freq = sweep_calculate();
+  if (freq <= 2047 && (sweep & 7)) {
+    c->shadow_freq = freq;
+    u16 *cnt_x = (u16 *)&memory_get_io()[SOUND1CNT_X];
+    *cnt_x = (*cnt_x & ~0x7FF) | freq;
+    sweep_calculate(); // Overflow check with the new frequency
+  }
+}
+
+static void clock_envelope(void) {
+  static const u32 env_reg_offset[4] = {SOUND1CNT_H, SOUND2CNT_L, 0, SOUND4CNT_L};
+  for (int i = 0; i < 4; i++) {
+    if (i == 2) continue;
+    u16 env = reg16(env_reg_offset[i]);
+    int period = (env >> 8) & 7;
+    if (period == 0) continue;
+    if (--psg[i].env_timer > 0) continue;
+    psg[i].env_timer = period;
+    if ((env & 0x0800) && psg[i].volume < 15) psg[i].volume++;
+    else if (!(env & 0x0800) && psg[i].volume > 0) psg[i].volume--;
+  }
+}
+
+static void frame_sequencer_step(void) {
+  if ((frame_seq_step & 1) == 0) clock_length();
+  if (frame_seq_step == 2 || frame_seq_step == 6) clock_sweep();
+  if (frame_seq_step == 7) clock_envelope();
+  frame_seq_step = (frame_seq_step + 1) & 7;
+}
+
+// Channel Output (signed, -15..15)
+
+static int square_output(int ch, int cycles) {
+  PsgChannel *c = &psg[ch];
+  u16 duty_reg = reg16(ch == 0 ? SOUND1CNT_H : SOUND2CNT_L);
+  u16 cnt_x = reg16(ch == 0 ? SOUND1CNT_X : SOUND2CNT_H);
+  c->position = (c->position + advance_timer(&c->timer, square_period(cnt_x), cycles)) & 7;
+  if (!c->enabled) return 0;
+  return duty_table[(duty_reg >> 6) & 3][c->position] ? c->volume : -c->volume;
+}
+
+static int wave_output(int cycles) {
+  PsgChannel *c = &psg[2];
+  u8 cnt_l = memory_get_io()[SOUND3CNT_L];
+  u16 cnt_h = reg16(SOUND3CNT_H);
+  int samples = (cnt_l & 0x20) ? 64 : 32;
+  c->position = (c->position + advance_timer(&c->timer, wave_period(reg16(SOUND3CNT_X)), cycles)) %
+                samples;
+  if (!c->enabled || !(cnt_l & 0x80)) return 0;
+
+  // 64-digit mode plays the selected bank first, then the other one
+  int bank = ((cnt_l >> 6) & 1) ^ (c->position >> 5);
+  int index = c->position & 31;
+  u8 byte = wave_ram[bank][index >> 1];
+  int nibble = (index & 1) ? (byte & 0xF) : (byte >> 4);
+  int out = nibble * 2 - 15;
+
+  if (cnt_h & 0x8000) return out * 3 / 4;
+  switch ((cnt_h >> 13) & 3) {
+  case 0: return 0;
+  case 1: return out;
+  case 2: return out / 2;
+  default: return out / 4;
+  }
+}
+
+static int noise_output(int cycles) {
+  PsgChannel *c = &psg[3];
+  u16 cnt_h = reg16(SOUND4CNT_H);
+  int steps = advance_timer(&c->timer, noise_period(cnt_h), cycles);
+  u16 tap = (cnt_h & 0x08) ? 0x60 : 0x6000;
+  while (steps--) {
+    c->noise_high = c->lfsr & 1;
+    c->lfsr >>= 1;
+    if (c->noise_high) c->lfsr ^= tap;
+  }
+  if (!c->enabled) return 0;
+  return c->noise_high ? c->volume : -c->volume;
+}
+
+// Resampler: 32768 Hz -> 48000 Hz
+// 48000 / 32768 = 375 / 256, so output sample k sits at input position
+// k * 256 / 375. Each of the 375 phases has its own 16-tap Blackman-windowed
+// sinc with the cutoff below the input Nyquist frequency.
+
+#define RESAMPLE_TAPS 16
+#define RESAMPLE_UP 375
+#define RESAMPLE_DOWN 256
+#define RESAMPLE_CUTOFF 0.45 // Cycles per input sample
+#define HISTORY_SIZE 1024
+#define HISTORY_KEEP 32
+
+static float resample_coef[RESAMPLE_UP][RESAMPLE_TAPS] __attribute__((aligned(16)));
+static float history_l[HISTORY_SIZE], history_r[HISTORY_SIZE];
+static int history_len;
+static s64 history_base;  // Absolute input index of history[0]
+static s64 input_count;   // Input samples produced so far
+static s64 output_count;  // Output samples produced so far
+
+static void resampler_init(void) {
+  const double pi = 3.14159265358979323846;
+  const double half = RESAMPLE_TAPS / 2;
+  for (int p = 0; p < RESAMPLE_UP; p++) {
+    double frac = (double)p / RESAMPLE_UP;
+    double sum = 0;
+    for (int j = 0; j < RESAMPLE_TAPS; j++) {
+      // Tap j reads input (i - 7 + j); distance from the output position
+      double x = frac + (half - 1) - j;
+      double arg = 2.0 * RESAMPLE_CUTOFF * x;
+      double sinc = (x == 0) ? 1.0 : sin(pi * arg) / (pi * arg);
+      double w = 0.42 + 0.5 * cos(pi * x / half) + 0.08 * cos(2 * pi * x / half);
+      double h = 2.0 * RESAMPLE_CUTOFF * sinc * w;
+      resample_coef[p][j] = (float)h;
+      sum += h;
+    }
+    // Unity DC gain for every phase
+    for (int j = 0; j < RESAMPLE_TAPS; j++) resample_coef[p][j] /= (float)sum;
+  }
+
+  memset(history_l, 0, sizeof(history_l));
+  memset(history_r, 0, sizeof(history_r));
+  // Start with silence in front of the first sample
+  history_len = RESAMPLE_TAPS;
+  history_base = -RESAMPLE_TAPS;
+  input_count = 0;
+  output_count = 0;
+}
+
+static inline void dot16_stereo(const float *l, const float *r, const float *c, float *out_l,
+                                float *out_r) {
+#ifdef __SSE__
+  __m128 acc_l = _mm_setzero_ps();
+  __m128 acc_r = _mm_setzero_ps();
+  for (int j = 0; j < RESAMPLE_TAPS; j += 4) {
+    __m128 coef = _mm_load_ps(c + j);
+    acc_l = _mm_add_ps(acc_l, _mm_mul_ps(_mm_loadu_ps(l + j), coef));
+    acc_r = _mm_add_ps(acc_r, _mm_mul_ps(_mm_loadu_ps(r + j), coef));
+  }
+  // Horizontal sums of both accumulators at once
+  __m128 lo = _mm_unpacklo_ps(acc_l, acc_r); // l0 r0 l1 r1
+  __m128 hi = _mm_unpackhi_ps(acc_l, acc_r); // l2 r2 l3 r3
+  __m128 sum = _mm_add_ps(lo, hi);
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  float res[4];
+  _mm_storeu_ps(res, sum);
+  *out_l = res[0];
+  *out_r = res[1];
+#else
+  float sl = 0, sr = 0;
+  for (int j = 0; j < RESAMPLE_TAPS; j++) {
+    sl += l[j] * c[j];
+    sr += r[j] * c[j];
+  }
+  *out_l = sl;
+  *out_r = sr;
+#endif
+}
+
+// Ring Buffer (SPSC, lock-free)
+// The emulation thread is the only producer; the SDL audio callback or the
+// WAV writer is the only consumer.
+
+#define RING_FRAMES 16384 // ~340ms at 48 kHz, power of two
+static s16 ring[RING_FRAMES * 2];
+static _Atomic u32 ring_head;
+static _Atomic u32 ring_tail;
+static u64 ring_dropped;
+
+static void ring_push(s16 l, s16 r) {
+  u32 head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+  u32 tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+  if (head - tail >= RING_FRAMES) {
+    ring_dropped++; // Consumer is not keeping up
+    return;
+  }
+  u32 idx = (head & (RING_FRAMES - 1)) * 2;
+  ring[idx] = l;
+  ring[idx + 1] = r;
+  atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+int apu_samples_available(void) {
+  return (int)(atomic_load_explicit(&ring_head, memory_order_acquire) -
+               atomic_load_explicit(&ring_tail, memory_order_relaxed));
+}
+
+int apu_read_samples(s16 *out, int frames) {
+  u32 tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+  u32 head = atomic_load_explicit(&ring_head, memory_order_acquire);
+  u32 n = head - tail;
+  if (n > (u32)frames) n = frames;
+
+  // Copy in at most two pieces around the wrap point
+  u32 start = tail & (RING_FRAMES - 1);
+  u32 first = RING_FRAMES - start;
+  if (first > n) first = n;
+  memcpy(out, &ring[start * 2], first * 2 * sizeof(s16));
+  memcpy(out + first * 2, ring, (n - first) * 2 * sizeof(s16));
+
+  atomic_store_explicit(&ring_tail, tail + n, memory_order_release);
+  return (int)n;
+}
+
+static inline s16 to_s16(float v) {
+  if (v > 32767.0f) return 32767;
+  if (v < -32768.0f) return -32768;
+  return (s16)lrintf(v);
+}
+
+static void resampler_push(s16 l, s16 r) {
+  if (history_len == HISTORY_SIZE) {
+    // Keep the tail needed by the pending outputs
+    memmove(history_l, history_l + HISTORY_SIZE - HISTORY_KEEP, HISTORY_KEEP * sizeof(float));
+    memmove(history_r, history_r + HISTORY_SIZE - HISTORY_KEEP, HISTORY_KEEP * sizeof(float));
+    history_base += HISTORY_SIZE - HISTORY_KEEP;
+    history_len = HISTORY_KEEP;
+  }
+  history_l[history_len] = l;
+  history_r[history_len] = r;
+  history_len++;
+  input_count++;
+
+  for (;;) {
+    s64 pos = output_count * RESAMPLE_DOWN;
+    s64 i = pos / RESAMPLE_UP;
+    int phase = (int)(pos % RESAMPLE_UP);
+    // Needs inputs i-7 .. i+8
+    if (i + RESAMPLE_TAPS / 2 >= input_count) break;
+
+    int start = (int)(i - (RESAMPLE_TAPS / 2 - 1) - history_base);
+    float out_l, out_r;
+    dot16_stereo(&history_l[start], &history_r[start], resample_coef[phase], &out_l, &out_r);
+    ring_push(to_s16(out_l), to_s16(out_r));
+    output_count++;
+  }
+}
+
+// Mixer
+
+static void mix_sample(void) {
+  u8 *io = memory_get_io();
+  int ch_out[4];
+  ch_out[0] = square_output(0, APU_CYCLES_PER_MIX);
+  ch_out[1] = square_output(1, APU_CYCLES_PER_MIX);
+  ch_out[2] = wave_output(APU_CYCLES_PER_MIX);
+  ch_out[3] = noise_output(APU_CYCLES_PER_MIX);
+  update_status();
+
+  if (!(io[SOUNDCNT_X] & 0x80)) {
+    resampler_push(0, 0);
+    return;
+  }
+
+  u16 cnt_l = reg16(SOUNDCNT_L);
+  u16 cnt_h = reg16(SOUNDCNT_H);
+
+  // PSG: sum of enabled channels (+-60) times master volume 1-8 (+-480),
+  // then the 25/50/100% PSG ratio
+  int psg_r = 0, psg_l = 0;
+  for (int i = 0; i < 4; i++) {
+    if (cnt_l & (0x100 << i)) psg_r += ch_out[i];
+    if (cnt_l & (0x1000 << i)) psg_l += ch_out[i];
+  }
+  psg_r *= (cnt_l & 7) + 1;
+  psg_l *= ((cnt_l >> 4) & 7) + 1;
+  int psg_shift = 2 - (cnt_h & 3);
+  if (psg_shift < 0) psg_shift = 0; // 3 is prohibited
+  psg_r >>= psg_shift;
+  psg_l >>= psg_shift;
+
+  // Direct Sound: 8-bit samples at 50% (x2) or 100% (x4), +-512
+  int a = fifo[0].sample * ((cnt_h & 0x04) ? 4 : 2);
+  int b = fifo[1].sample * ((cnt_h & 0x08) ? 4 : 2);
+  int right = psg_r, left = psg_l;
+  if (cnt_h & 0x0100) right += a;
+  if (cnt_h & 0x0200) left += a;
+  if (cnt_h & 0x1000) right += b;
+  if (cnt_h & 0x2000) left += b;
+
+  // 10-bit DAC: add bias, clip to 0..3FF, re-center
+  int bias = reg16(SOUNDBIAS) & 0x3FE;
+  right += bias;
+  left += bias;
+  if (right < 0) right = 0;
+  if (right > 0x3FF) right = 0x3FF;
+  if (left < 0) left = 0;
+  if (left > 0x3FF) left = 0x3FF;
+  resampler_push((s16)((left - 0x200) * 64), (s16)((right - 0x200) * 64));
+}
+
+void apu_step(int cycles) {
+  frame_seq_timer -= cycles;
+  while (frame_seq_timer <= 0) {
+    frame_seq_timer += FRAME_SEQ_CYCLES;
+    frame_sequencer_step();
+  }
+
+  mix_timer -= cycles;
+  while (mix_timer <= 0) {
+    mix_timer += APU_CYCLES_PER_MIX;
+    mix_sample();
+  }
+}
+
+// Direct Sound FIFOs
+
+static void fifo_reset(SoundFifo *f) {
+  f->read = 0;
+  f->count = 0;
+}
+
+static void fifo_push(SoundFifo *f, u8 byte) {
+  if (f->count == 32) return; // Full: hardware drops the write
+  f->data[(f->read + f->count) & 31] = (s8)byte;
+  f->count++;
+}
+
+void apu_fifo_write32(int index, u32 value) {
+  for (int i = 0; i < 4; i++) fifo_push(&fifo[index], (value >> (i * 8)) & 0xFF);
+}
+
+void apu_timer_overflow(int timer) {
+  u16 cnt_h = reg16(SOUNDCNT_H);
+  if (!(memory_get_io()[SOUNDCNT_X] & 0x80)) return;
+
+  for (int i = 0; i < 2; i++) {
+    int fifo_timer = (cnt_h >> (10 + i * 4)) & 1;
+    if (fifo_timer != timer) continue;
+
+    SoundFifo *f = &fifo[i];
+    if (f->count > 0) {
+      f->sample = f->data[f->read];
+      f->read = (f->read + 1) & 31;
+      f->count--;
+    }
+    // Half empty: ask DMA1/2 for 4 more words
+    if (f->count <= 16) {
+      dma_sound_request(i == 0 ? APU_FIFO_A : APU_FIFO_B);
+    }
+  }
+}
+
+// Register Writes
+
+static void write_byte(u32 offset, u8 value) {
+  u8 *io = memory_get_io();
+  switch (offset) {
+  case SOUND1CNT_H: psg[0].length = 64 - (value & 0x3F); break;
+  case SOUND2CNT_L: psg[1].length = 64 - (value & 0x3F); break;
+  case SOUND3CNT_H: psg[2].length = 256 - value; break;
+  case SOUND4CNT_L: psg[3].length = 64 - (value & 0x3F); break;
+
+  // Envelope register writes that turn the DAC off silence the channel
+  case SOUND1CNT_H + 1: if (!envelope_dac_on(reg16(SOUND1CNT_H))) psg[0].enabled = false; break;
+  case SOUND2CNT_L + 1: if (!envelope_dac_on(reg16(SOUND2CNT_L))) psg[1].enabled = false; break;
+  case SOUND4CNT_L + 1: if (!envelope_dac_on(reg16(SOUND4CNT_L))) psg[3].enabled = false; break;
+  case SOUND3CNT_L: if (!(value & 0x80)) psg[2].enabled = false; break;
+
+  // Restart bits (write-only)
+  case SOUND1CNT_X + 1: if (value & 0x80) trigger_channel(0); io[offset] &= 0x7F; break;
+  case SOUND2CNT_H + 1: if (value & 0x80) trigger_channel(1); io[offset] &= 0x7F; break;
+  case SOUND3CNT_X + 1: if (value & 0x80) trigger_channel(2); io[offset] &= 0x7F; break;
+  case SOUND4CNT_H + 1: if (value & 0x80) trigger_channel(3); io[offset] &= 0x7F; break;
+
+  case SOUNDCNT_H + 1:
+    // FIFO reset bits read back as zero
+    if (value & 0x08) fifo_reset(&fifo[0]);
+    if (value & 0x80) fifo_reset(&fifo[1]);
+    io[offset] &= 0x77;
+    break;
+
+  case SOUNDCNT_X:
+    if (!(value & 0x80)) {
+      // Master disable resets the PSG registers and channels; SOUNDCNT_H
+      // (DMA sound, PSG volume) keeps its value
+      memset(&io[SOUND1CNT_L], 0, SOUNDCNT_L + 2 - SOUND1CNT_L);
+      for (int i = 0; i < 4; i++) psg[i].enabled = false;
+    }
+    update_status();
+    break;
+
+  default:
+    if (offset >= WAVE_RAM && offset < WAVE_RAM + 16) {
+      // The CPU accesses the bank that is not selected for playback
+      int bank = ((io[SOUND3CNT_L] >> 6) & 1) ^ 1;
+      wave_ram[bank][offset - WAVE_RAM] = value;
+    } else if (offset >= FIFO_A_OFS && offset < FIFO_A_OFS + 4) {
+      fifo_push(&fifo[0], value);
+    } else if (offset >= FIFO_B_OFS && offset < FIFO_B_OFS + 4) {
+      fifo_push(&fifo[1], value);
+    }
+    break;
+  }
+}
+
+void apu_io_write(u32 offset, u32 value, int size) {
+  for (int i = 0; i < size; i++) write_byte(offset + i, (value >> (i * 8)) & 0xFF);
+}
+
+void apu_init(void) {
+  memset(psg, 0, sizeof(psg));
+  memset(fifo, 0, sizeof(fifo));
+  memset(wave_ram, 0, sizeof(wave_ram));
+  frame_seq_timer = FRAME_SEQ_CYCLES;
+  frame_seq_step = 0;
+  mix_timer = APU_CYCLES_PER_MIX;
+  resampler_init();
+  atomic_store(&ring_head, 0);
+  atomic_store(&ring_tail, 0);
+  ring_dropped = 0;
+
+  // SOUNDBIAS resets to mid-scale
+  *(u16 *)&memory_get_io()[SOUNDBIAS] = 0x0200;
+}
+
+// WAV Output
+
+static FILE *wav_file = NULL;
+static u32 wav_frames = 0;
+
+static void put_le32(u8 *p, u32 v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static void wav_write_header(u32 frames) {
+  u8 h[44];
+  u32 data_bytes = frames * 4;
+  memcpy(h, "RIFF", 4);
+  put_le32(h + 4, 36 + data_bytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put_le32(h + 16, 16);                 // fmt chunk size
+  h[20] = 1; h[21] = 0;                 // PCM
+  h[22] = 2; h[23] = 0;                 // Stereo
+  put_le32(h + 24, APU_OUTPUT_RATE);
+  put_le32(h + 28, APU_OUTPUT_RATE * 4); // Byte rate
+  h[32] = 4; h[33] = 0;                 // Block align
+  h[34] = 16; h[35] = 0;                // Bits per sample
+  memcpy(h + 36, "data", 4);
+  put_le32(h + 40, data_bytes);
+  fseek(wav_file, 0, SEEK_SET);
+  fwrite(h, 1, sizeof(h), wav_file);
+}
+
+bool apu_wav_open(const char *filename) {
+  wav_file = fopen(filename, "wb");
+  if (!wav_file) {
+    printf("Failed to create WAV: %s\n", filename);
+    return false;
+  }
+  wav_frames = 0;
+  wav_write_header(0); // Sizes patched on close
+  return true;
+}
+
+void apu_wav_drain(void) {
+  if (!wav_file) return;
+  static s16 chunk[4096 * 2];
+  int n;
+  while ((n = apu_read_samples(chunk, 4096)) > 0) {
+    fwrite(chunk, sizeof(s16) * 2, n, wav_file);
+    wav_frames += n;
+  }
+}
+
+void apu_wav_close(void) {
+  if (!wav_file) return;
+  apu_wav_drain();
+  wav_write_header(wav_frames);
+  fclose(wav_file);
+  wav_file = NULL;
+  printf("[APU] WAV written: %u frames (%.2fs)\n", wav_frames,
+         (double)wav_frames / APU_OUTPUT_RATE);
+  if (ring_dropped) printf("[APU] %llu samples dropped\n", (unsigned long long)ring_dropped);
+}
@@ -0,0 +1,250 @@
+#include "../include/backup.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static BackupType type = BACKUP_NONE;
+static u8 *data = NULL;
+static size_t data_size = 0;
+
+// Flash command state
+static int flash_stage;       // 0: expect AA@5555, 1: expect 55@2AAA, 2: command
+static bool flash_id_mode;
+static bool flash_erase;      // 0x80 seen, waiting for the erase command
+static bool flash_write;      // 0xA0 seen, next write programs a byte
+static bool flash_bank_switch; // 0xB0 seen, next write to 0x0000 selects the bank
+static int flash_bank;
+
+// EEPROM serial state
+static u8 ee_bits[81];
+static int ee_count;
+static int ee_addr_bits = 14;
+static bool ee_reading;
+static int ee_read_pos;
+static u32 ee_read_block;
+
+static const struct {
+  const char *id;
+  BackupType type;
+} backup_ids[] = {
+    {"EEPROM_V", BACKUP_EEPROM},  {"SRAM_V", BACKUP_SRAM},
+    {"SRAM_F_V", BACKUP_SRAM},    {"FLASH_V", BACKUP_FLASH64},
+    {"FLASH512_V", BACKUP_FLASH64}, {"FLASH1M_V", BACKUP_FLASH128},
+};
+
+BackupType backup_detect(const u8 *rom, u32 size) {
+  if (!rom) return BACKUP_NONE;
+  // ID strings are word aligned
+  for (u32 i = 0; i + 12 <= size; i += 4) {
+    if (rom[i] != 'E' && rom[i] != 'S' && rom[i] != 'F') continue;
+    for (size_t k = 0; k < sizeof(backup_ids) / sizeof(backup_ids[0]); k++) {
+      size_t len = strlen(backup_ids[k].id);
+      if (memcmp(&rom[i], backup_ids[k].id, len) == 0) return backup_ids[k].type;
+    }
+  }
+  return BACKUP_NONE;
+}
+
+const char *backup_type_name(BackupType t) {
+  switch (t) {
+  case BACKUP_SRAM: return "SRAM 32KB";
+  case BACKUP_FLASH64: return "Flash 64KB";
+  case BACKUP_FLASH128: return "Flash 128KB";
+  case BACKUP_EEPROM: return "EEPROM";
+  default: return "None";
+  }
+}
+
+static size_t backup_size(BackupType t) {
+  switch (t) {
+  case BACKUP_SRAM: return BACKUP_SRAM_SIZE;
+  case BACKUP_FLASH64: return BACKUP_FLASH64_SIZE;
+  case BACKUP_FLASH128: return BACKUP_FLASH128_SIZE;
+  case BACKUP_EEPROM: return BACKUP_EEPROM_SIZE;
+  default: return 0;
+  }
+}
+
+bool backup_init(BackupType t, const char *save_path) {
+  backup_close();
+  type = t;
+  flash_stage = 0;
+  flash_id_mode = flash_erase = flash_write = flash_bank_switch = false;
+  flash_bank = 0;
+  ee_count = 0;
+  ee_reading = false;
+  ee_addr_bits = 14;
+  data_size = backup_size(t);
+  if (data_size == 0) return true;
+
+  if (!save_path) {
+    data = mmap(NULL, data_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      data = NULL;
+      return false;
+    }
+    memset(data, 0xFF, data_size);
+    return true;
+  }
+
+  int fd = open(save_path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    printf("Failed to open save file: %s\n", save_path);
+    return false;
+  }
+  struct stat st;
+  fstat(fd, &st);
+  size_t existing = st.st_size;
+  // A 512-byte file is a small EEPROM
+  if (t == BACKUP_EEPROM && existing == 512) ee_addr_bits = 6;
+  if (existing < data_size && ftruncate(fd, data_size) != 0) {
+    close(fd);
+    return false;
+  }
+  data = mmap(NULL, data_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); // The mapping keeps the file referenced
+  if (data == MAP_FAILED) {
+    data = NULL;
+    printf("Failed to map save file: %s\n", save_path);
+    return false;
+  }
+  // Fresh or grown file: erased state
+  if (existing < data_size) memset(data + existing, 0xFF, data_size - existing);
+  printf("Backup: %s (%s)\n", backup_type_name(t), save_path);
+  return true;
+}
+
+void backup_close(void) {
+  if (data) munmap(data, data_size);
+  data = NULL;
+  data_size = 0;
+  type = BACKUP_NONE;
+}
+
+BackupType backup_type(void) { return type; }
+
+// SRAM / Flash
+
+u8 backup_read8(u32 addr) {
+  u32 a = addr & 0xFFFF;
+  switch (type) {
+  case BACKUP_SRAM:
+    return data[a & 0x7FFF];
+  case BACKUP_FLASH64:
+  case BACKUP_FLASH128:
+    if (flash_id_mode && a < 2) {
+      // Panasonic MN63F805MNP (64K), Sanyo LE26FV10N1TS (128K)
+      if (type == BACKUP_FLASH64) return a ? 0x1B : 0x32;
+      return a ? 0x13 : 0x62;
+    }
+    return data[flash_bank * 0x10000 + a];
+  default:
+    return 0xFF;
+  }
+}
+
+static void flash_command(u32 a, u8 value) {
+  if (flash_erase) {
+    flash_erase = false;
+    if (a == 0x5555 && value == 0x10) {
+      memset(data, 0xFF, data_size); // Chip erase
+    } else if (value == 0x30) {
+      memset(&data[flash_bank * 0x10000 + (a & 0xF000)], 0xFF, 0x1000); // 4KB sector
+    }
+    return;
+  }
+  if (a != 0x5555) return;
+  switch (value) {
+  case 0x90: flash_id_mode = true; break;
+  case 0xF0: flash_id_mode = false; break;
+  case 0x80: flash_erase = true; break;
+  case 0xA0: flash_write = true; break;
+  case 0xB0: flash_bank_switch = (type == BACKUP_FLASH128); break;
+  }
+}
+
+void backup_write8(u32 addr, u8 value) {
+  u32 a = addr & 0xFFFF;
+  if (type == BACKUP_SRAM) {
+    data[a & 0x7FFF] = value;
+    return;
+  }
+  if (type != BACKUP_FLASH64 && type != BACKUP_FLASH128) return;
+
+  if (flash_write) {
+    flash_write = false;
+    data[flash_bank * 0x10000 + a] = value;
+    return;
+  }
+  if (flash_bank_switch && a == 0) {
+    flash_bank_switch = false;
+    flash_bank = value & 1;
+    return;
+  }
+
+  switch (flash_stage) {
+  case 0:
+    if (a == 0x5555 && value == 0xAA) flash_stage = 1;
+    break;
+  case 1:
+    flash_stage = (a == 0x2AAA && value == 0x55) ? 2 : 0;
+    break;
+  case 2:
+    flash_stage = 0;
+    flash_command(a, value);
+    break;
+  }
+}
+
+// EEPROM
+// Requests are bit streams, MSB first:
+//   read:  1 1 <addr> 0          -> 4 dummy bits + 64 data bits
+//   write: 1 0 <addr> <64 bits> 0
+
+void backup_eeprom_hint(u32 count) {
+  if (count == 9 || count == 73) ee_addr_bits = 6;
+  else if (count == 17 || count == 81) ee_addr_bits = 14;
+}
+
+static u32 ee_bits_value(int start, int n) {
+  u32 v = 0;
+  for (int i = 0; i < n; i++) v = (v << 1) | ee_bits[start + i];
+  return v;
+}
+
+static u32 ee_block_mask(void) { return ee_addr_bits == 6 ? 0x3F : 0x3FF; }
+
+void backup_eeprom_write(u16 value) {
+  if (type != BACKUP_EEPROM) return;
+  ee_reading = false;
+  if (ee_count < (int)sizeof(ee_bits)) ee_bits[ee_count++] = value & 1;
+  if (ee_count < 2) return;
+
+  int cmd = ee_bits[0] << 1 | ee_bits[1];
+  int request_len = 2 + ee_addr_bits + 1;
+  if (cmd == 3 && ee_count == request_len) {
+    ee_read_block = ee_bits_value(2, ee_addr_bits) & ee_block_mask();
+    ee_read_pos = 0;
+    ee_reading = true;
+    ee_count = 0;
+  } else if (cmd == 2 && ee_count == request_len + 64) {
+    u32 block = ee_bits_value(2, ee_addr_bits) & ee_block_mask();
+    for (int i = 0; i < 8; i++) {
+      data[block * 8 + i] = (u8)ee_bits_value(2 + ee_addr_bits + i * 8, 8);
+    }
+    ee_count = 0;
+  } else if (cmd < 2) {
+    ee_count = 0; // Not a request
+  }
+}
+
+u16 backup_eeprom_read(void) {
+  if (type != BACKUP_EEPROM || !ee_reading) return 1; // Ready
+  int pos = ee_read_pos++;
+  if (ee_read_pos == 68) ee_reading = false;
+  if (pos < 4) return 0;
+  pos -= 4;
+  return (data[ee_read_block * 8 + pos / 8] >> (7 - pos % 8)) & 1;
+}
@@ -1,6 +1,8 @@
 #include "../include/bios.h"
 #include "../include/memory.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Helper to read/write memory
 // We use bus_read/bus_write from memory.h
@@ -41,47 +43,133 @@ void swi_register_ram_reset(ARM7TDMI *cpu) {
     }
 }
 
+// Data bus cost of `count` sequential accesses that the fast paths
+// performed through host pointers
+static void charge_sequential(u32 addr, u32 count, bool is_32) {
+    if (count == 0) return;
+    bus_cycles += memory_access_cycles(addr, is_32, false) +
+                  (count - 1) * memory_access_cycles(addr, is_32, true);
+}
+
+// BIOS loop overhead per unit moved (LDR/STR loop vs. 8-word LDM/STM)
+#define CPUSET_CYCLES_UNIT 4
+#define CPUFASTSET_CYCLES_WORD 1
+
+// Copy or fill `count` units of `size` bytes in ascending order, like the
+// BIOS loops. Host memcpy/fill when both ranges are plain memory; the bus
+// for IO or region-crossing ranges.
+static void block_set(u32 src, u32 dst, u32 count, int size, bool fill) {
+    u32 len = count * size;
+    if (count == 0) return;
+    const u8 *from = memory_region_ptr(src, fill ? (u32)size : len, false);
+    u8 *to = memory_region_ptr(dst, len, true);
+
+    if (from && to) {
+        charge_sequential(src, fill ? 1 : count, size == 4);
+        charge_sequential(dst, count, size == 4);
+        if (fill && size == 4) {
+            u32 value = *(const u32 *)from;
+            u32 *words = (u32 *)to;
+            if ((value & 0xFF) * 0x01010101u == value) memset(to, value & 0xFF, len);
+            else for (u32 i = 0; i < count; i++) words[i] = value;
+        } else if (fill) {
+            u16 value = *(const u16 *)from;
+            u16 *halves = (u16 *)to;
+            for (u32 i = 0; i < count; i++) halves[i] = value;
+        } else if (to > from && to < from + len) {
+            // Forward overlap: an ascending copy repeats the source pattern
+            for (u32 i = 0; i < len; i += size) memmove(to + i, from + i, size);
+        } else {
+            memmove(to, from, len);
+        }
+        return;
+    }
+
+    if (size == 4) {
+        u32 value = bus_read32(src);
+        for (u32 i = 0; i < count; i++) {
+            if (!fill && i) value = bus_read32(src + i * 4);
+            bus_write32(dst + i * 4, value);
+        }
+    } else {
+        u16 value = bus_read16(src);
+        for (u32 i = 0; i < count; i++) {
+            if (!fill && i) value = bus_read16(src + i * 2);
+            bus_write16(dst + i * 2, value);
+        }
+    }
+}
+
 void swi_cpu_set(ARM7TDMI *cpu) {
     // 0x0B: CpuSet(src, dst, control)
-    u32 src = cpu->r[0];
-    u32 dst = cpu->r[1];
+    // Control: bits 0-20 unit count, bit 24 fixed source (fill), bit 26 32-bit
     u32 len_ctrl = cpu->r[2];
-    
-    int count = len_ctrl & 0x1FFFFF;
-    bool is_32 = len_ctrl & 0x04000000; // Bit 26
-    bool fixed_src = len_ctrl & 0x01000000; // Bit 24
-    
-    // printf("[BIOS] CpuSet Src=%08X Dst=%08X Len=%X 32bit=%d Fixed=%d\n", src, dst, count, is_32, fixed_src);
-    
-    if (is_32) {
-        for (int i=0; i<count; i++) {
-            u32 val = bus_read32(fixed_src ? src : src + i*4);
-            bus_write32(dst + i*4, val);
-        }
+    u32 count = len_ctrl & 0x1FFFFF;
+    bool fixed_src = len_ctrl & 0x01000000;
+
+    if (len_ctrl & 0x04000000) {
+        block_set(cpu->r[0] & ~3u, cpu->r[1] & ~3u, count, 4, fixed_src);
     } else {
-        for (int i=0; i<count; i++) {
-            u16 val = bus_read16(fixed_src ? src : src + i*2);
-            bus_write16(dst + i*2, val);
-        }
+        block_set(cpu->r[0] & ~1u, cpu->r[1] & ~1u, count, 2, fixed_src);
     }
+    bus_cycles += count * CPUSET_CYCLES_UNIT;
 }
 
 void swi_cpu_fast_set(ARM7TDMI *cpu) {
     // 0x0C: CpuFastSet(src, dst, control)
-    // Always 32-bit copy. count is in words.
-    u32 src = cpu->r[0];
-    u32 dst = cpu->r[1];
+    // Always 32-bit, in blocks of 8 words: the count rounds up
     u32 len_ctrl = cpu->r[2];
-    
-    int count = len_ctrl & 0x1FFFFF;
-    bool fixed_src = len_ctrl & 0x01000000; // Bit 24
-    
-    // printf("[BIOS] CpuFastSet Src=%08X Dst=%08X Len=%X\n", src, dst, count);
-    
-    for (int i=0; i<count; i++) {
-        u32 val = bus_read32(fixed_src ? src : src + i*4);
-        bus_write32(dst + i*4, val);
+    u32 count = ((len_ctrl & 0x1FFFFF) + 7) & ~7u;
+    bool fixed_src = len_ctrl & 0x01000000;
+
+    block_set(cpu->r[0] & ~3u, cpu->r[1] & ~3u, count, 4, fixed_src);
+    bus_cycles += count * CPUFASTSET_CYCLES_WORD;
+}
+
+// Decompression cost of the BIOS routines, on top of the data accesses:
+// per flag byte, per literal, per back-reference and per copied byte
+#define LZ77_CYCLES_FLAGS 8
+#define LZ77_CYCLES_LITERAL 12
+#define LZ77_CYCLES_REFERENCE 20
+#define LZ77_CYCLES_COPY 7
+
+// Bus fallback: the stream or the output crosses a region boundary (or
+// lives in IO/unmapped space). The Vram variant buffers output into
+// halfwords, so back-references can't see a pending odd byte.
+static void lz77_uncomp_bus(u32 src, u32 dst, u32 size, bool wram) {
+    u32 out = 0;
+    u16 pending = 0;
+    while (out < size) {
+        u8 flags = bus_read8(src++);
+        bus_cycles += LZ77_CYCLES_FLAGS;
+        for (int i = 0; i < 8 && out < size; i++, flags <<= 1) {
+            u32 length = 1;
+            u32 copy_src = 0;
+            bool reference = flags & 0x80;
+            if (reference) {
+                // Block: Length-3 (4 bits) | Disp-1 (12 bits), high byte first
+                u8 b1 = bus_read8(src++);
+                u8 b2 = bus_read8(src++);
+                length = (b1 >> 4) + 3;
+                copy_src = dst + out - ((((b1 & 0xF) << 8) | b2) + 1);
+                bus_cycles += LZ77_CYCLES_REFERENCE;
+            } else {
+                bus_cycles += LZ77_CYCLES_LITERAL;
+            }
+            for (u32 j = 0; j < length && out < size; j++, out++) {
+                u8 val = reference ? bus_read8(copy_src++) : bus_read8(src++);
+                if (reference) bus_cycles += LZ77_CYCLES_COPY;
+                if (wram) {
+                    bus_write8(dst + out, val);
+                } else if (out & 1) {
+                    bus_write16(dst + out - 1, pending | (val << 8));
+                } else {
+                    pending = val;
+                }
+            }
+        }
     }
+    if (!wram && (size & 1)) bus_write16(dst + size - 1, pending);
 }
 
 void swi_lz77_uncomp(ARM7TDMI *cpu, bool wram) {
@@ -89,137 +177,785 @@ void swi_lz77_uncomp(ARM7TDMI *cpu, bool wram) {
     // R0: Source, R1: Dest
     u32 src = cpu->r[0];
     u32 dst = cpu->r[1];
-    
-    // Read Header
+
+    // Header: type 0x10, decompressed size in bits 31-8
     u32 header = bus_read32(src);
+    if ((header & 0xF0) != 0x10) {
+        printf("[BIOS] LZ77 Fail: Invalid Header %08X at %08X\n", header, src);
+        return;
+    }
+    u32 size = header >> 8;
     src += 4;
-    
-    // Compression Type (Bit 4-7 = 1) -> 0x10
-    if ((header & 0xFF) != 0x10) {
-        printf("[BIOS] LZ77 Fail: Invalid Header %08X at %08X\n", header, src-4);
+
+    // Resolve both ends once. The stream is at most one flag byte per 8
+    // literals, plus one byte when the last token is a reference clipped to
+    // a single output byte; shorter regions fall back to the bus.
+    const u8 *in = memory_region_ptr(src, size + 1 + (size + 7) / 8, false);
+    u8 *base = memory_region_ptr(dst, (size + 1) & ~1u, true);
+    if (!in || !base) {
+        lz77_uncomp_bus(src, dst, size, wram);
         return;
     }
-    
-    u32 decompressed_size = header >> 8;
-    printf("[BIOS] LZ77UnComp%s Src=%08X Dst=%08X Size=%X\n", wram ? "Wram" : "Vram", src-4, dst, decompressed_size);
-    
-    u32 current_out_size = 0;
-    
-    while (current_out_size < decompressed_size) {
-        u8 flags = bus_read8(src++);
-        for (int i=0; i<8; i++) {
-             if (current_out_size >= decompressed_size) break;
-             
-             if (flags & 0x80) { // Compressed
-                 // Read 2 bytes
-                 u8 b1 = bus_read8(src++);
-                 u8 b2 = bus_read8(src++);
-                 
-                 // (b1<<8) | b2  -> Disp: MSB 4 bits of b2 | b1. Len: Low 4 bits of b2 + 3.
-                 // Actually:
-                 // Flags: 1, then data is (DispMSB(4) Len(4)) (DispLSB(8))
-                 // Wait, standard GBA LZ77:
-                 // Data = (Byte1 << 8) | Byte2
-                 // Length = (Byte1 >> 4) + 3
-                 // Disp = ((Byte1 & 0xF) << 8) | Byte2
-                 
-                 // Let's re-read specs carefully.
-                 // "Load 2 bytes: Data = [src] OR [src+1]<<8"? No Endianness matters.
-                 // We read byte by byte.
-                 
-                 // GBATEK: 
-                 // Flag=1: Compressed.
-                 // Read Block (16-bit): D L D D D D D D D D D D
-                 // Length = (Block >> 12) + 3. 
-                 // Disp = (Block & 0xFFF).
-                 // Disp is offset BACKWARDS from current dest. 
-                 
-                 // My read: b1 is first byte, b2 is second. 
-                 // 16-bit var = (b2 << 8) | b1? No, GBA is Little Endian.
-                 // But this is a stream.
-                 // Usually: D L (High byte) ...
-                 // Let's use simple logic:
-                 // Block = bus_read8(src) | (bus_read8(src+1)<<8) ??
-                 // NO. The stream is read byte-by-byte.
-                 // Byte 1: (Length_High | Disp_High)
-                 // Byte 2: Disp_Low
-                 
-                 // GBA Little Endian:
-                 // Byte 1 (b1) = Disp LSB
-                 // Byte 2 (b2) = Length | Disp MSB
-                 
-                 int length = (b2 >> 4) + 3;
-                 int disp_high = b2 & 0xF;
-                 int disp_low = b1;
-                 int disp = (disp_high << 8) | disp_low;
-                 
-                 // Copy from (dst - disp - 1)
-                 u32 copy_src = dst - disp - 1;
-                 for (int j=0; j<length; j++) {
-                     if (current_out_size >= decompressed_size) break;
-                     // We must read from the *output* buffer (which might be VRAM)
-                     // bus_read8 handles VRAM reading.
-                     u8 val = bus_read8(copy_src++); 
-                     bus_write8(dst++, val);
-                     current_out_size++;
-                 }
-                 
-             } else { // Uncompressed
-                 u8 val = bus_read8(src++);
-                 bus_write8(dst++, val);
-                 current_out_size++;
-             }
-             flags <<= 1;
+
+    // The Vram variant writes whole halfwords; producing the same bytes in
+    // place is equivalent except that a distance-1 reference from an odd
+    // position reads the old byte under the halfword still being assembled
+    const u8 *start = in;
+    u8 *out = base;
+    u8 *end = base + size;
+    u32 references = 0, copied = 0, flag_bytes = 0;
+    u8 stale = 0;
+
+    while (out < end) {
+        u8 flags = *in++;
+        flag_bytes++;
+        for (int i = 0; i < 8 && out < end; i++, flags <<= 1) {
+            u32 length = 1, dist = 0;
+            if (flags & 0x80) {
+                // Block: Length-3 (4 bits) | Disp-1 (12 bits), high byte first
+                length = (in[0] >> 4) + 3;
+                dist = (((in[0] & 0xF) << 8) | in[1]) + 1;
+                in += 2;
+                if (length > (u32)(end - out)) length = end - out;
+            }
+            u32 pos = out - base;
+            if (!wram && ((pos + length) & 1)) stale = base[pos + length - 1];
+
+            if (!dist) {
+                *out++ = *in++;
+                continue;
+            }
+            references++;
+            copied += length;
+
+            if (dist > pos) {
+                // Reference reaches before the destination: read via the bus
+                u32 from = dst + pos - dist;
+                for (u32 j = 0; j < length; j++) *out++ = bus_read8(from + j);
+            } else if (!wram && dist == 1) {
+                for (u32 j = 0; j < length; j++, out++) {
+                    if ((out - base) & 1) {
+                        *out = stale;
+                    } else {
+                        stale = *out;
+                        *out = out[-1];
+                    }
+                }
+            } else {
+                if (dist >= 4) {
+                    // Source and destination words don't overlap
+                    for (; length >= 4; length -= 4, out += 4) memcpy(out, out - dist, 4);
+                }
+                for (; length; length--, out++) *out = *(out - dist);
+            }
+        }
+    }
+
+    u32 literals = size - copied;
+    charge_sequential(src, in - start, false);
+    if (wram)
+        charge_sequential(dst, size, false);
+    else
+        charge_sequential(dst, (size + 1) / 2, false);
+    bus_cycles += flag_bytes * LZ77_CYCLES_FLAGS + literals * LZ77_CYCLES_LITERAL +
+                  references * LZ77_CYCLES_REFERENCE + copied * LZ77_CYCLES_COPY;
+}
+
+// Per-unit cost of the remaining BIOS decoders, on top of data accesses
+#define RL_CYCLES_FLAG 10
+#define RL_CYCLES_BYTE 5
+#define HUFF_CYCLES_BIT 4
+#define DIFF_CYCLES_UNIT 6
+#define BITUNPACK_CYCLES_UNIT 8
+
+// Source stream: host reads while the region lasts, then the bus
+typedef struct {
+    const u8 *ptr;
+    u32 avail;
+    u32 host_bytes;
+    u32 addr;
+} Stream;
+
+static void stream_open(Stream *s, u32 addr) {
+    s->addr = addr;
+    s->ptr = memory_region_span(addr, false, &s->avail);
+    if (!s->ptr) s->avail = 0;
+    s->host_bytes = s->avail;
+}
+
+static inline u8 stream_u8(Stream *s) {
+    u32 addr = s->addr++;
+    if (s->avail) {
+        s->avail--;
+        return *s->ptr++;
+    }
+    return bus_read8(addr);
+}
+
+static inline u32 stream_u32(Stream *s) {
+    u32 b0 = stream_u8(s), b1 = stream_u8(s), b2 = stream_u8(s);
+    return b0 | (b1 << 8) | (b2 << 16) | ((u32)stream_u8(s) << 24);
+}
+
+static void stream_close(Stream *s, u32 start) {
+    charge_sequential(start, s->host_bytes - s->avail, false);
+}
+
+// Output: the destination itself when it is one plain region, otherwise a
+// scratch buffer flushed through the bus (8, 16 or 32-bit stores)
+typedef struct {
+    u8 *buf;
+    u32 dst;
+    u32 size;
+    bool host;
+} Output;
+
+static bool output_open(Output *o, u32 dst, u32 size) {
+    o->dst = dst;
+    o->size = size;
+    o->buf = memory_region_ptr(dst, (size + 3) & ~3u, true);
+    o->host = o->buf != NULL;
+    if (!o->host) o->buf = calloc(1, (size + 3) & ~3u);
+    return o->buf != NULL;
+}
+
+static void output_close(Output *o, int unit) {
+    if (o->host) {
+        charge_sequential(o->dst, (o->size + unit - 1) / unit, unit == 4);
+        return;
+    }
+    u32 i = 0;
+    if (unit == 4) {
+        for (; i < o->size; i += 4) bus_write32(o->dst + i, *(u32 *)&o->buf[i]);
+    } else if (unit == 2) {
+        for (; i + 1 < o->size; i += 2) bus_write16(o->dst + i, o->buf[i] | (o->buf[i + 1] << 8));
+        // Trailing odd byte: keep the neighbour
+        if (i < o->size) bus_write16(o->dst + i, (bus_read16(o->dst + i) & 0xFF00) | o->buf[i]);
+    } else {
+        for (; i < o->size; i++) bus_write8(o->dst + i, o->buf[i]);
+    }
+    free(o->buf);
+}
+
+static bool read_header(Stream *s, u32 type, u32 *size, u32 *unit_bits) {
+    u32 header = stream_u32(s);
+    if ((header & 0xF0) != type) {
+        printf("[BIOS] Decompress Fail: Header %08X at %08X, expected type %02X\n", header,
+               s->addr - 4, type);
+        return false;
+    }
+    *size = header >> 8;
+    if (unit_bits) *unit_bits = header & 0xF;
+    return true;
+}
+
+void swi_rl_uncomp(ARM7TDMI *cpu, bool wram) {
+    // 0x14: RLUnCompWram / 0x15: RLUnCompVram
+    Stream in;
+    Output out;
+    u32 size;
+    u32 src = cpu->r[0];
+    stream_open(&in, src);
+    if (!read_header(&in, 0x30, &size, NULL) || !output_open(&out, cpu->r[1], size)) return;
+
+    u32 pos = 0;
+    while (pos < size) {
+        u8 flag = stream_u8(&in);
+        u32 length = flag & 0x7F;
+        bus_cycles += RL_CYCLES_FLAG;
+        if (flag & 0x80) {
+            // Run: one byte repeated Length+3 times
+            length += 3;
+            if (length > size - pos) length = size - pos;
+            memset(&out.buf[pos], stream_u8(&in), length);
+        } else {
+            // Literal: Length+1 bytes
+            length += 1;
+            if (length > size - pos) length = size - pos;
+            for (u32 i = 0; i < length; i++) out.buf[pos + i] = stream_u8(&in);
+        }
+        pos += length;
+        bus_cycles += length * RL_CYCLES_BYTE;
+    }
+    stream_close(&in, src);
+    output_close(&out, wram ? 1 : 2);
+}
+
+void swi_diff_unfilter(ARM7TDMI *cpu, int width, bool wram) {
+    // 0x16: Diff8bitUnFilterWram / 0x17: Diff8bitUnFilterVram
+    // 0x18: Diff16bitUnFilter
+    Stream in;
+    Output out;
+    u32 size, unit_bits;
+    u32 src = cpu->r[0];
+    stream_open(&in, src);
+    if (!read_header(&in, 0x80, &size, &unit_bits) || !output_open(&out, cpu->r[1], size)) return;
+    if (unit_bits != (u32)width) {
+        printf("[BIOS] Diff%dbitUnFilter: header data size %u\n", width * 8, unit_bits);
+    }
+
+    if (width == 1) {
+        u8 sum = 0;
+        for (u32 i = 0; i < size; i++) out.buf[i] = sum += stream_u8(&in);
+    } else {
+        u16 sum = 0;
+        for (u32 i = 0; i + 1 < size; i += 2) {
+            u16 delta = stream_u8(&in);
+            delta |= stream_u8(&in) << 8;
+            sum += delta;
+            out.buf[i] = sum;
+            out.buf[i + 1] = sum >> 8;
+        }
+    }
+    bus_cycles += (size / width) * DIFF_CYCLES_UNIT;
+    stream_close(&in, src);
+    output_close(&out, (width == 1 && wram) ? 1 : 2);
+}
+
+// Huffman tree walk for codes that start with an 8-bit prefix: the leaf
+// value and code length, or the node reached after all 8 bits
+typedef struct {
+    u16 node;
+    u8 length;
+    bool leaf;
+} HuffEntry;
+
+static inline u32 huff_child(const u8 *tree, u32 pos, u32 bit) {
+    return ((pos & ~1u) + (tree[pos] & 0x3F) * 2 + 2 + bit) & 0x1FF;
+}
+
+static inline bool huff_is_leaf(const u8 *tree, u32 pos, u32 bit) {
+    return tree[pos] & (bit ? 0x40 : 0x80);
+}
+
+void swi_huff_uncomp(ARM7TDMI *cpu) {
+    // 0x13: HuffUnCompReadNormal
+    Stream in;
+    Output out;
+    u32 size, unit_bits;
+    u32 src = cpu->r[0];
+    stream_open(&in, src);
+    if (!read_header(&in, 0x20, &size, &unit_bits)) return;
+    if (unit_bits != 4 && unit_bits != 8) {
+        printf("[BIOS] HuffUnComp: unsupported data size %u\n", unit_bits);
+        return;
+    }
+    if (!output_open(&out, cpu->r[1], (size + 3) & ~3u)) return;
+
+    // Tree: size byte, then nodes; positions are offsets from src + 4
+    u8 tree[0x200] = {0};
+    u32 tree_bytes = (u32)(stream_u8(&in) + 1) * 2;
+    for (u32 i = 1; i < tree_bytes; i++) tree[i] = stream_u8(&in);
+
+    HuffEntry table[256];
+    for (u32 prefix = 0; prefix < 256; prefix++) {
+        HuffEntry e = {1, 8, false};
+        for (u32 k = 0; k < 8; k++) {
+            u32 bit = (prefix >> (7 - k)) & 1;
+            u32 child = huff_child(tree, e.node, bit);
+            bool leaf = huff_is_leaf(tree, e.node, bit);
+            e.node = child;
+            if (leaf) {
+                e.node = tree[child];
+                e.length = k + 1;
+                e.leaf = true;
+                break;
+            }
         }
+        table[prefix] = e;
     }
+
+    // Bitstream: 32-bit words, most significant bit first
+    u64 bits = 0;
+    u32 count = 0, total_bits = 0;
+    u32 word = 0, word_bits = 0, pos = 0;
+    u32 mask = (1u << unit_bits) - 1;
+    while (pos < out.size) {
+        if (count < 32) {
+            bits = (bits << 32) | stream_u32(&in);
+            count += 32;
+        }
+        HuffEntry e = table[(bits >> (count - 8)) & 0xFF];
+        count -= e.length;
+        total_bits += e.length;
+        u32 value = e.node;
+        if (!e.leaf) {
+            // Code longer than 8 bits: finish the walk bit by bit
+            u32 node = e.node;
+            for (;;) {
+                if (count == 0) {
+                    bits = stream_u32(&in);
+                    count = 32;
+                }
+                u32 bit = (bits >> --count) & 1;
+                total_bits++;
+                u32 child = huff_child(tree, node, bit);
+                if (huff_is_leaf(tree, node, bit)) {
+                    value = tree[child];
+                    break;
+                }
+                node = child;
+            }
+        }
+        // Units fill each output word from the least significant bit
+        word |= (value & mask) << word_bits;
+        word_bits += unit_bits;
+        if (word_bits == 32) {
+            memcpy(&out.buf[pos], &word, 4);
+            pos += 4;
+            word = 0;
+            word_bits = 0;
+        }
+    }
+    bus_cycles += total_bits * HUFF_CYCLES_BIT;
+    stream_close(&in, src);
+    output_close(&out, 4);
+}
+
+// One source unit widened by BitUnPack
+static inline u32 unpack_unit(u32 value, u32 offset, bool zero_data) {
+    return (value || zero_data) ? value + offset : 0;
+}
+
+void swi_bit_unpack(ARM7TDMI *cpu) {
+    // 0x10: BitUnPack(src, dst, info)
+    // Info: u16 source length, u8 source width, u8 dest width,
+    //       u32 offset (bit 31: also add it to zero units)
+    u32 info = cpu->r[2];
+    u32 length = bus_read16(info);
+    u32 src_width = bus_read8(info + 2);
+    u32 dst_width = bus_read8(info + 3);
+    u32 offset = bus_read32(info + 4);
+    bool zero_data = offset & 0x80000000;
+    offset &= 0x7FFFFFFF;
+
+    if (!src_width || src_width > 8 || (src_width & (src_width - 1)) || !dst_width ||
+        dst_width > 32 || (dst_width & (dst_width - 1)) || dst_width < src_width) {
+        printf("[BIOS] BitUnPack: unsupported widths %u -> %u\n", src_width, dst_width);
+        return;
+    }
+
+    Stream in;
+    Output out;
+    u32 src = cpu->r[0];
+    u32 units = length * 8 / src_width;
+    stream_open(&in, src);
+    if (!output_open(&out, cpu->r[1] & ~3u, (units * dst_width / 8) & ~3u)) return;
+    u32 src_mask = (1u << src_width) - 1;
+
+    if (dst_width == src_width * 4) {
+        // Each source byte becomes exactly one word (1->4 and 2->8 bpp font
+        // expansion): translate through a 256-entry table
+        u32 lut[256];
+        for (u32 b = 0; b < 256; b++) {
+            u32 word = 0;
+            for (u32 bit = 0, shift = 0; bit < 8; bit += src_width, shift += dst_width) {
+                word |= unpack_unit((b >> bit) & src_mask, offset, zero_data) << shift;
+            }
+            lut[b] = word;
+        }
+        u32 *words = (u32 *)out.buf;
+        for (u32 i = 0; i < out.size / 4; i++) words[i] = lut[stream_u8(&in)];
+    } else {
+        u32 word = 0, word_bits = 0, pos = 0;
+        for (u32 i = 0; i < length && pos < out.size; i++) {
+            u8 b = stream_u8(&in);
+            for (u32 bit = 0; bit < 8; bit += src_width) {
+                u32 value = unpack_unit((b >> bit) & src_mask, offset, zero_data);
+                word |= (dst_width == 32) ? value : value << word_bits;
+                word_bits += dst_width;
+                if (word_bits == 32) {
+                    memcpy(&out.buf[pos], &word, 4);
+                    pos += 4;
+                    word = 0;
+                    word_bits = 0;
+                }
+            }
+        }
+    }
+    bus_cycles += units * BITUNPACK_CYCLES_UNIT;
+    stream_close(&in, src);
+    output_close(&out, 4);
+}
+
+// Approximate BIOS cost of the math routines
+#define DIV_CYCLES 60
+#define SQRT_CYCLES 80
+#define ARCTAN_CYCLES 50
+#define AFFINE_CYCLES 40 // Per matrix
+
+// BIOS sine table: sin(2 * pi * i / 256) in 1.14 fixed point, truncated
+static const s16 bios_sine[256] = {
+    0, 402, 803, 1205, 1605, 2005, 2404, 2801,
+    3196, 3589, 3980, 4369, 4756, 5139, 5519, 5896,
+    6269, 6639, 7005, 7366, 7723, 8075, 8423, 8765,
+    9102, 9434, 9759, 10079, 10393, 10701, 11002, 11297,
+    11585, 11866, 12139, 12406, 12665, 12916, 13159, 13395,
+    13622, 13842, 14053, 14255, 14449, 14634, 14810, 14978,
+    15136, 15286, 15426, 15557, 15678, 15790, 15892, 15985,
+    16069, 16142, 16206, 16260, 16305, 16339, 16364, 16379,
+    16384, 16379, 16364, 16339, 16305, 16260, 16206, 16142,
+    16069, 15985, 15892, 15790, 15678, 15557, 15426, 15286,
+    15136, 14978, 14810, 14634, 14449, 14255, 14053, 13842,
+    13622, 13395, 13159, 12916, 12665, 12406, 12139, 11866,
+    11585, 11297, 11002, 10701, 10393, 10079, 9759, 9434,
+    9102, 8765, 8423, 8075, 7723, 7366, 7005, 6639,
+    6269, 5896, 5519, 5139, 4756, 4369, 3980, 3589,
+    3196, 2801, 2404, 2005, 1605, 1205, 803, 402,
+    0, -402, -803, -1205, -1605, -2005, -2404, -2801,
+    -3196, -3589, -3980, -4369, -4756, -5139, -5519, -5896,
+    -6269, -6639, -7005, -7366, -7723, -8075, -8423, -8765,
+    -9102, -9434, -9759, -10079, -10393, -10701, -11002, -11297,
+    -11585, -11866, -12139, -12406, -12665, -12916, -13159, -13395,
+    -13622, -13842, -14053, -14255, -14449, -14634, -14810, -14978,
+    -15136, -15286, -15426, -15557, -15678, -15790, -15892, -15985,
+    -16069, -16142, -16206, -16260, -16305, -16339, -16364, -16379,
+    -16384, -16379, -16364, -16339, -16305, -16260, -16206, -16142,
+    -16069, -15985, -15892, -15790, -15678, -15557, -15426, -15286,
+    -15136, -14978, -14810, -14634, -14449, -14255, -14053, -13842,
+    -13622, -13395, -13159, -12916, -12665, -12406, -12139, -11866,
+    -11585, -11297, -11002, -10701, -10393, -10079, -9759, -9434,
+    -9102, -8765, -8423, -8075, -7723, -7366, -7005, -6639,
+    -6269, -5896, -5519, -5139, -4756, -4369, -3980, -3589,
+    -3196, -2801, -2404, -2005, -1605, -1205, -803, -402,
+};
+
+// Signed division as the BIOS performs it. Division by zero hangs the
+// real BIOS for |num| > 1; return what it produces for the other cases.
+static void bios_div(s32 num, s32 den, u32 *quot, u32 *rem, u32 *abs_quot) {
+    if (den == 0) {
+        *quot = (num < 0) ? (u32)-1 : 1;
+        *rem = num;
+        *abs_quot = 1;
+    } else if (den == -1 && num == INT32_MIN) {
+        *quot = (u32)INT32_MIN;
+        *rem = 0;
+        *abs_quot = (u32)INT32_MIN;
+    } else {
+        s32 q = num / den;
+        *quot = q;
+        *rem = num % den;
+        *abs_quot = (q < 0) ? -(u32)q : (u32)q;
+    }
+    bus_cycles += DIV_CYCLES;
 }
 
 void swi_div(ARM7TDMI *cpu) {
     // 0x06: Div (R0 / R1)
     // Results: R0 = Quot, R1 = Rem, R3 = Abs(Quot)
-    int32_t num = (int32_t)cpu->r[0];
-    int32_t den = (int32_t)cpu->r[1];
-    
-    if (den == 0) {
-        // Division by zero behavior? 
-        // Usually returns large value or hangs. 
-        // For now, avoid crash.
-        cpu->r[0] = 0; 
-        cpu->r[1] = 0; // ?
-    } else {
-        cpu->r[0] = num / den;
-        cpu->r[1] = num % den;
-        cpu->r[3] = (cpu->r[0] < 0) ? -cpu->r[0] : cpu->r[0];
+    bios_div(cpu->r[0], cpu->r[1], &cpu->r[0], &cpu->r[1], &cpu->r[3]);
+}
+
+void swi_div_arm(ARM7TDMI *cpu) {
+    // 0x07: DivArm (R1 / R0), same results as Div
+    bios_div(cpu->r[1], cpu->r[0], &cpu->r[0], &cpu->r[1], &cpu->r[3]);
+}
+
+void swi_sqrt(ARM7TDMI *cpu) {
+    // 0x08: Sqrt (unsigned R0), integer result
+    u32 value = cpu->r[0];
+    u32 root = 0;
+    for (u32 bit = 1u << 30; bit; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
     }
+    cpu->r[0] = root;
+    bus_cycles += SQRT_CYCLES;
 }
 
-void swi_vblank_intr_wait(ARM7TDMI *cpu) {
-    // 0x05: VBlankIntrWait
-    // Explicitly halts the CPU until VBlank IRQ occurs.
+// BIOS arctangent polynomial for 1.14 fixed-point tan in [-1, 1]:
+// returns the angle (0x4000 = pi/2); R1/R3 receive the intermediates
+static s16 bios_arctan(s32 i, u32 *r1, u32 *r3) {
+    // 32-bit multiplies wrap like the ARM's MUL
+#define MUL(x, y) ((s32)((u32)(x) * (u32)(y)))
+    s32 a = -(MUL(i, i) >> 14);
+    s32 b = (MUL(0xA9, a) >> 14) + 0x390;
+    b = (MUL(b, a) >> 14) + 0x91C;
+    b = (MUL(b, a) >> 14) + 0xFB6;
+    b = (MUL(b, a) >> 14) + 0x16AA;
+    b = (MUL(b, a) >> 14) + 0x2081;
+    b = (MUL(b, a) >> 14) + 0x3651;
+    b = (MUL(b, a) >> 14) + 0xA2F9;
+    if (r1) *r1 = a;
+    if (r3) *r3 = b;
+    bus_cycles += ARCTAN_CYCLES;
+    return MUL(i, b) >> 16;
+#undef MUL
+}
+
+void swi_arctan(ARM7TDMI *cpu) {
+    // 0x09: ArcTan (R0 = tan, 1.14 fixed point)
+    cpu->r[0] = (s32)bios_arctan(cpu->r[0], &cpu->r[1], &cpu->r[3]);
+}
+
+// Octant reduction of ArcTan2 around bios_arctan
+static u16 bios_arctan2(s32 x, s32 y, u32 *r1) {
+    u32 quot, rem, abs_quot;
+    if (!y) return (x >= 0) ? 0 : 0x8000;
+    if (!x) return (y >= 0) ? 0x4000 : 0xC000;
+    if (y >= 0) {
+        if (x >= 0) {
+            if (x >= y) {
+                bios_div((s32)((u32)y << 14), x, &quot, &rem, &abs_quot);
+                return bios_arctan(quot, r1, NULL);
+            }
+        } else if (-x >= y) {
+            bios_div((s32)((u32)y << 14), x, &quot, &rem, &abs_quot);
+            return bios_arctan(quot, r1, NULL) + 0x8000;
+        }
+        bios_div((s32)((u32)x << 14), y, &quot, &rem, &abs_quot);
+        return 0x4000 - bios_arctan(quot, r1, NULL);
+    }
+    if (x <= 0) {
+        if (-x > -y) {
+            bios_div((s32)((u32)y << 14), x, &quot, &rem, &abs_quot);
+            return bios_arctan(quot, r1, NULL) + 0x8000;
+        }
+    } else if (x >= -y) {
+        bios_div((s32)((u32)y << 14), x, &quot, &rem, &abs_quot);
+        return bios_arctan(quot, r1, NULL) + 0x10000;
+    }
+    bios_div((s32)((u32)x << 14), y, &quot, &rem, &abs_quot);
+    return 0xC000 - bios_arctan(quot, r1, NULL);
+}
+
+void swi_arctan2(ARM7TDMI *cpu) {
+    // 0x0A: ArcTan2 (R0 = X, R1 = Y), angle 0x0000-0xFFFF
+    cpu->r[0] = bios_arctan2(cpu->r[0], cpu->r[1], &cpu->r[1]);
+    cpu->r[3] = 0x170;
+}
+
+// Rotation/scale matrix from 8.8 scales and an 8-bit angle (theta >> 8)
+typedef struct {
+    s16 pa, pb, pc, pd;
+} AffineMatrix;
+
+static inline AffineMatrix affine_matrix(s32 sx, s32 sy, u32 theta) {
+    s32 sine = bios_sine[theta & 0xFF];
+    s32 cosine = bios_sine[(theta + 0x40) & 0xFF];
+    AffineMatrix m = {(sx * cosine) >> 14, (-sx * sine) >> 14, (sy * sine) >> 14,
+                      (sy * cosine) >> 14};
+    return m;
+}
+
+void swi_bg_affine_set(ARM7TDMI *cpu) {
+    // 0x0E: BgAffineSet(src, dst, count)
+    // Source (20 bytes): s32 ox, oy (texture center, 19.8); s16 cx, cy
+    // (screen center); s16 sx, sy (8.8); u16 theta
+    // Dest (16 bytes): s16 pa, pb, pc, pd; s32 x, y (BGxX/BGxY)
+    u32 src = cpu->r[0];
+    u32 dst = cpu->r[1];
+    u32 count = cpu->r[2];
+    for (u32 i = 0; i < count; i++, src += 20, dst += 16) {
+        s32 ox = bus_read32(src);
+        s32 oy = bus_read32(src + 4);
+        s32 cx = (s16)bus_read16(src + 8);
+        s32 cy = (s16)bus_read16(src + 10);
+        AffineMatrix m = affine_matrix((s16)bus_read16(src + 12), (s16)bus_read16(src + 14),
+                                       bus_read16(src + 16) >> 8);
+        bus_write16(dst, m.pa);
+        bus_write16(dst + 2, m.pb);
+        bus_write16(dst + 4, m.pc);
+        bus_write16(dst + 6, m.pd);
+        bus_write32(dst + 8, ox - (m.pa * cx + m.pb * cy));
+        bus_write32(dst + 12, oy - (m.pc * cx + m.pd * cy));
+    }
+    bus_cycles += count * AFFINE_CYCLES;
+}
+
+void swi_obj_affine_set(ARM7TDMI *cpu) {
+    // 0x0F: ObjAffineSet(src, dst, count, stride)
+    // Source (8 bytes): s16 sx, sy (8.8); u16 theta; padding
+    // Dest: pa, pb, pc, pd as s16, R3 bytes apart (2 = packed, 8 = OAM)
+    u32 src = cpu->r[0];
+    u32 dst = cpu->r[1];
+    u32 count = cpu->r[2];
+    u32 stride = cpu->r[3];
+    bus_cycles += count * AFFINE_CYCLES;
+
+    // Whole batch in plain memory (typically a shadow OAM in WRAM): build
+    // every matrix from the host arrays in one pass
+    const u8 *in = memory_region_ptr(src, count * 8, false);
+    u8 *out = (count && !(stride & 1)) ? memory_region_ptr(dst, count * stride * 4, true) : NULL;
+    if (in && out && !(src & 1) && !(dst & 1)) {
+        const s16 *params = (const s16 *)in;
+        s16 *elems = (s16 *)out;
+        u32 step = stride / 2;
+        for (u32 i = 0; i < count; i++, params += 4, elems += step * 4) {
+            AffineMatrix m = affine_matrix(params[0], params[1], (u16)params[2] >> 8);
+            elems[0] = m.pa;
+            elems[step] = m.pb;
+            elems[step * 2] = m.pc;
+            elems[step * 3] = m.pd;
+        }
+        charge_sequential(src, count * 3, false);
+        charge_sequential(dst, count * 4, false);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++, src += 8, dst += stride * 4) {
+        AffineMatrix m = affine_matrix((s16)bus_read16(src), (s16)bus_read16(src + 2),
+                                       bus_read16(src + 4) >> 8);
+        bus_write16(dst, m.pa);
+        bus_write16(dst + stride, m.pb);
+        bus_write16(dst + stride * 2, m.pc);
+        bus_write16(dst + stride * 3, m.pd);
+    }
+}
+
+void swi_halt(ARM7TDMI *cpu) {
+    // 0x02: Halt until any enabled interrupt is requested
     cpu->halted = true;
-    
-    // Also, usually this function sets VBlank IRQ Enable in IE?
-    // GBA Bios does: IE |= 1 (VBlank).
-    u16 ie = bus_read16(0x04000200);
-    bus_write16(0x04000200, ie | 1);
 }
 
-void bios_handle_swi(ARM7TDMI *cpu, u8 swi_number) {
-    if (swi_number != 0x05 && swi_number != 0x04) { // Filter VBlankIntrWait/IntrWait
-        printf("[BIOS] Handling SWI %02X\n", swi_number);
+void swi_stop(ARM7TDMI *cpu) {
+    // 0x03: Stop until a keypad, serial or GamePak interrupt
+    cpu->halted = true;
+    cpu->stopped = true;
+}
+
+// Interrupt handlers acknowledge requests here as well as in IF; the
+// BIOS waits test and clear this word
+#define BIOS_IF 0x03007FF8
+
+// Set while an IntrWait is halted and will be re-executed; the retry must
+// not discard the flag the handler just set
+static bool intr_wait_pending = false;
+
+void swi_intr_wait(ARM7TDMI *cpu) {
+    // 0x04: IntrWait(discard_old, flags)
+    // R0 = 1 discards flags already set and waits for a new one
+    u16 flags = cpu->r[1];
+    bus_write16(0x04000208, 1); // IME = 1
+
+    u16 bios_if = bus_read16(BIOS_IF);
+    if ((cpu->r[0] & 1) && !intr_wait_pending) {
+        bios_if &= ~flags;
+        bus_write16(BIOS_IF, bios_if);
     }
+    if (bios_if & flags) {
+        bus_write16(BIOS_IF, bios_if & ~flags);
+        intr_wait_pending = false;
+        return;
+    }
+
+    // Halt, then run this SWI again after the interrupt handler returns
+    intr_wait_pending = true;
+    cpu->halted = true;
+    cpu_repeat_instruction(cpu);
+}
+
+void swi_vblank_intr_wait(ARM7TDMI *cpu) {
+    // 0x05: VBlankIntrWait = IntrWait(1, VBlank)
+    cpu->r[0] = 1;
+    cpu->r[1] = 1;
+    swi_intr_wait(cpu);
+}
+
+// IRQ path of the real BIOS, so handlers return through SUBS PC, LR, #4
+// exactly as on hardware
+static const u32 bios_irq_stub[] = {
+    0xE92D500F, // 0x128: STMFD SP!, {R0-R3, R12, LR}
+    0xE3A00301, // 0x12C: MOV R0, #0x04000000
+    0xE28FE000, // 0x130: ADD LR, PC, #0
+    0xE510F004, // 0x134: LDR PC, [R0, #-4] (handler at 0x03FFFFFC)
+    0xE8BD500F, // 0x138: LDMFD SP!, {R0-R3, R12, LR}
+    0xE25EF004, // 0x13C: SUBS PC, LR, #4
+};
+
+bool bios_lle = false;
+static u64 bios_accel = BIOS_ACCEL_DEFAULT;
+
+void bios_init(ARM7TDMI *cpu) {
+    bios_lle = false;
+    u8 image[0x140] = {0};
+    u32 branch = 0xEA000042; // 0x18: B 0x128
+    memcpy(&image[0x18], &branch, 4);
+    memcpy(&image[0x128], bios_irq_stub, sizeof(bios_irq_stub));
+    memory_load_bios(image, sizeof(image));
+
+    u32 mode = cpu->cpsr & 0x1F;
+    cpu_switch_mode(cpu, 0x12);
+    cpu->r[REG_SP] = 0x03007FA0;
+    cpu_switch_mode(cpu, 0x13);
+    cpu->r[REG_SP] = 0x03007FE0;
+    cpu_switch_mode(cpu, 0x1F);
+    cpu->r[REG_SP] = 0x03007F00;
+    cpu_switch_mode(cpu, mode);
+}
+
+bool bios_load_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("Failed to open BIOS: %s\n", path);
+        return false;
+    }
+    u8 *image = malloc(BIOS_SIZE);
+    size_t got = image ? fread(image, 1, BIOS_SIZE, f) : 0;
+    fclose(f);
+    if (got != BIOS_SIZE) {
+        printf("BIOS image must be %d bytes: %s\n", BIOS_SIZE, path);
+        free(image);
+        return false;
+    }
+    memory_load_bios(image, BIOS_SIZE);
+    free(image);
+    bios_lle = true;
+    printf("Loaded BIOS: %s\n", path);
+    return true;
+}
+
+void bios_set_accelerators(u64 mask) {
+    // SoftReset (0x00) and Halt..VBlankIntrWait (0x02-0x05) change control flow
+    bios_accel = mask & ~0x3Dull;
+}
+
+void bios_swi_entry(ARM7TDMI *cpu) {
+    // Comment field of the calling opcode, as the BIOS handler reads it:
+    // byte 0 of a Thumb SWI or byte 2 of an ARM one, both at LR - 2
+    u32 ret = cpu->r[REG_LR];
+    u8 swi_number = bus_read8(ret - 2);
+    if (swi_number >= 64 || !((bios_accel >> swi_number) & 1)) return;
+
+    // Run in the caller's mode and return as MOVS PC, LR would
+    cpu_set_cpsr(cpu, cpu->spsr);
+    bios_handle_swi(cpu, swi_number);
+    cpu->r[REG_PC] = ret;
+}
+
+void bios_handle_swi(ARM7TDMI *cpu, u8 swi_number) {
     switch (swi_number) {
         case 0x00: swi_soft_reset(cpu); break;
         case 0x01: swi_register_ram_reset(cpu); break;
         
+        case 0x02: swi_halt(cpu); break;
+        case 0x03: swi_stop(cpu); break;
+        case 0x04: swi_intr_wait(cpu); break;
         case 0x05: swi_vblank_intr_wait(cpu); break;
         case 0x06: swi_div(cpu); break;
+        case 0x07: swi_div_arm(cpu); break;
+        case 0x08: swi_sqrt(cpu); break;
+        case 0x09: swi_arctan(cpu); break;
+        case 0x0A: swi_arctan2(cpu); break;
         
         case 0x0B: swi_cpu_set(cpu); break;
         case 0x0C: swi_cpu_fast_set(cpu); break;
+        case 0x0E: swi_bg_affine_set(cpu); break;
+        case 0x0F: swi_obj_affine_set(cpu); break;
         
+        case 0x10: swi_bit_unpack(cpu); break;
         case 0x11: swi_lz77_uncomp(cpu, true); break; // LZ77 WRAM
         case 0x12: swi_lz77_uncomp(cpu, false); break; // LZ77 VRAM
+        case 0x13: swi_huff_uncomp(cpu); break;
+        case 0x14: swi_rl_uncomp(cpu, true); break; // RLE WRAM
+        case 0x15: swi_rl_uncomp(cpu, false); break; // RLE VRAM
+        case 0x16: swi_diff_unfilter(cpu, 1, true); break;
+        case 0x17: swi_diff_unfilter(cpu, 1, false); break;
+        case 0x18: swi_diff_unfilter(cpu, 2, false); break;
         
         default:
              printf("[BIOS] Unimplemented SWI %02X\n", swi_number);
@@ -0,0 +1,283 @@
+#include "../include/capture.h"
+#include "../include/ppu.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define FRAME_PIXELS (GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT)
+#define CHROMA_PIXELS ((GBA_SCREEN_WIDTH / 2) * (GBA_SCREEN_HEIGHT / 2))
+
+// GBA refresh rate is 16777216 / 280896 Hz (~59.73 fps)
+#define GBA_FPS_NUM 16777216
+#define GBA_FPS_DEN 280896
+
+// Writer State
+static FILE *capture_file = NULL;
+static CaptureFormat capture_format = CAPTURE_Y4M;
+static pthread_t writer_thread;
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_filled = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t slot_freed = PTHREAD_COND_INITIALIZER;
+
+// Double buffer: the emulator fills one slot while the writer drains the other
+static u32 slots[2][FRAME_PIXELS];
+static bool slot_full[2];
+static int produce_idx = 0;
+static bool stopping = false;
+static u64 frames_written = 0;
+
+// Output staging (writer thread only)
+static u8 out_buffer[6 + FRAME_PIXELS * 4]; // "FRAME\n" + largest payload
+static char stream_buffer[1 << 20];
+
+// Color Conversion
+// BT.601 limited range, integer coefficients scaled by 256:
+// Y = 16  + ( 66R + 129G +  25B + 128) >> 8
+// U = 128 + (-38R -  74G + 112B + 128) >> 8
+// V = 128 + (112R -  94G -  18B + 128) >> 8
+// Chroma uses the sum of a 2x2 block, so its rounding term and shift are x4.
+
+void capture_rgb_to_yuv420_scalar(const u32 *src, u8 *y, u8 *u, u8 *v) {
+  for (int row = 0; row < GBA_SCREEN_HEIGHT; row++) {
+    const u32 *line = &src[row * GBA_SCREEN_WIDTH];
+    for (int x = 0; x < GBA_SCREEN_WIDTH; x++) {
+      int r = (line[x] >> 16) & 0xFF;
+      int g = (line[x] >> 8) & 0xFF;
+      int b = line[x] & 0xFF;
+      y[row * GBA_SCREEN_WIDTH + x] = (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+  }
+
+  for (int row = 0; row < GBA_SCREEN_HEIGHT / 2; row++) {
+    const u32 *l0 = &src[(row * 2) * GBA_SCREEN_WIDTH];
+    const u32 *l1 = l0 + GBA_SCREEN_WIDTH;
+    for (int x = 0; x < GBA_SCREEN_WIDTH / 2; x++) {
+      u32 p[4] = {l0[x * 2], l0[x * 2 + 1], l1[x * 2], l1[x * 2 + 1]};
+      int r = 0, g = 0, b = 0;
+      for (int i = 0; i < 4; i++) {
+        r += (p[i] >> 16) & 0xFF;
+        g += (p[i] >> 8) & 0xFF;
+        b += p[i] & 0xFF;
+      }
+      int idx = row * (GBA_SCREEN_WIDTH / 2) + x;
+      u[idx] = (u8)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+      v[idx] = (u8)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+    }
+  }
+}
+
+#ifdef __SSE2__
+// Split 8 ARGB pixels into 16-bit R, G, B lanes
+static inline void unpack_rgb16(const u32 *px, __m128i *r, __m128i *g, __m128i *b) {
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  __m128i p0 = _mm_loadu_si128((const __m128i *)px);
+  __m128i p1 = _mm_loadu_si128((const __m128i *)(px + 4));
+  *b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+  *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                       _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+  *r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                       _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+// 8 luma samples. Sums stay below 65536, so wrapping 16-bit math plus a
+// logical shift is exact.
+static inline __m128i luma8(__m128i r, __m128i g, __m128i b) {
+  __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                              _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+  sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+  sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+  return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+// Chroma for 4 2x2 blocks. (a, b) pairs are multiplied and summed by madd,
+// so each 32-bit lane packs two 16-bit operands.
+static inline __m128i chroma4(__m128i rg, __m128i b1, __m128i coef_rg, __m128i coef_b1) {
+  __m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, coef_rg), _mm_madd_epi16(b1, coef_b1));
+  return _mm_add_epi32(_mm_srai_epi32(sum, 10), _mm_set1_epi32(128));
+}
+#endif
+
+void capture_rgb_to_yuv420(const u32 *src, u8 *y, u8 *u, u8 *v) {
+#ifdef __SSE2__
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i coef_u_rg = _mm_setr_epi16(-38, -74, -38, -74, -38, -74, -38, -74);
+  const __m128i coef_u_b1 = _mm_setr_epi16(112, 512, 112, 512, 112, 512, 112, 512);
+  const __m128i coef_v_rg = _mm_setr_epi16(112, -94, 112, -94, 112, -94, 112, -94);
+  const __m128i coef_v_b1 = _mm_setr_epi16(-18, 512, -18, 512, -18, 512, -18, 512);
+
+  // Width (240) is a multiple of 8, so no scalar tail is needed
+  for (int row = 0; row < GBA_SCREEN_HEIGHT; row += 2) {
+    const u32 *l0 = &src[row * GBA_SCREEN_WIDTH];
+    const u32 *l1 = l0 + GBA_SCREEN_WIDTH;
+    u8 *y0 = &y[row * GBA_SCREEN_WIDTH];
+    u8 *y1 = y0 + GBA_SCREEN_WIDTH;
+    int crow = (row / 2) * (GBA_SCREEN_WIDTH / 2);
+
+    for (int x = 0; x < GBA_SCREEN_WIDTH; x += 8) {
+      __m128i r0, g0, b0, r1, g1, b1;
+      unpack_rgb16(l0 + x, &r0, &g0, &b0);
+      unpack_rgb16(l1 + x, &r1, &g1, &b1);
+
+      __m128i ya = luma8(r0, g0, b0);
+      __m128i yb = luma8(r1, g1, b1);
+      _mm_storel_epi64((__m128i *)(y0 + x), _mm_packus_epi16(ya, ya));
+      _mm_storel_epi64((__m128i *)(y1 + x), _mm_packus_epi16(yb, yb));
+
+      // Vertical sum, then horizontal pair sum via madd with 1s
+      __m128i sr = _mm_madd_epi16(_mm_add_epi16(r0, r1), ones);
+      __m128i sg = _mm_madd_epi16(_mm_add_epi16(g0, g1), ones);
+      __m128i sb = _mm_madd_epi16(_mm_add_epi16(b0, b1), ones);
+      __m128i rg = _mm_or_si128(sr, _mm_slli_epi32(sg, 16));
+      __m128i b_one = _mm_or_si128(sb, _mm_slli_epi32(_mm_set1_epi32(1), 16));
+
+      __m128i cu = chroma4(rg, b_one, coef_u_rg, coef_u_b1);
+      __m128i cv = chroma4(rg, b_one, coef_v_rg, coef_v_b1);
+      __m128i packed = _mm_packs_epi32(cu, cv);       // u0..u3 v0..v3 (16-bit)
+      packed = _mm_packus_epi16(packed, packed);       // bytes
+      u32 u4 = (u32)_mm_cvtsi128_si32(packed);
+      u32 v4 = (u32)_mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+      memcpy(&u[crow + x / 2], &u4, 4);
+      memcpy(&v[crow + x / 2], &v4, 4);
+    }
+  }
+#else
+  capture_rgb_to_yuv420_scalar(src, y, u, v);
+#endif
+}
+
+void capture_argb_to_rgba(const u32 *src, u8 *dst, int pixels) {
+  for (int i = 0; i < pixels; i++) {
+    u32 c = src[i];
+    dst[i * 4 + 0] = (c >> 16) & 0xFF;
+    dst[i * 4 + 1] = (c >> 8) & 0xFF;
+    dst[i * 4 + 2] = c & 0xFF;
+    dst[i * 4 + 3] = (c >> 24) & 0xFF;
+  }
+}
+
+// Writer Thread
+
+static void write_frame(const u32 *frame) {
+  size_t len = 0;
+  if (capture_format == CAPTURE_Y4M) {
+    memcpy(out_buffer, "FRAME\n", 6);
+    u8 *y = out_buffer + 6;
+    u8 *u = y + FRAME_PIXELS;
+    u8 *v = u + CHROMA_PIXELS;
+    capture_rgb_to_yuv420(frame, y, u, v);
+    len = 6 + FRAME_PIXELS + CHROMA_PIXELS * 2;
+  } else {
+    capture_argb_to_rgba(frame, out_buffer, FRAME_PIXELS);
+    len = FRAME_PIXELS * 4;
+  }
+  if (fwrite(out_buffer, 1, len, capture_file) != len) {
+    fprintf(stderr, "[Capture] Write failed after %llu frames\n",
+            (unsigned long long)frames_written);
+  }
+  frames_written++;
+}
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  int consume_idx = 0;
+  pthread_mutex_lock(&slot_lock);
+  for (;;) {
+    while (!slot_full[consume_idx] && !stopping) {
+      pthread_cond_wait(&slot_filled, &slot_lock);
+    }
+    if (!slot_full[consume_idx]) break; // Stopping and drained
+    pthread_mutex_unlock(&slot_lock);
+
+    write_frame(slots[consume_idx]);
+
+    pthread_mutex_lock(&slot_lock);
+    slot_full[consume_idx] = false;
+    pthread_cond_signal(&slot_freed);
+    consume_idx ^= 1;
+  }
+  pthread_mutex_unlock(&slot_lock);
+  return NULL;
+}
+
+bool capture_open(const char *filename, CaptureFormat format) {
+  if (capture_file) return false;
+
+  if (strcmp(filename, "-") == 0) {
+    // Keep the real stdout for video and send console logs to stderr
+    fflush(stdout);
+    int video_fd = dup(STDOUT_FILENO);
+    if (video_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+      printf("Failed to redirect stdout for capture\n");
+      return false;
+    }
+    capture_file = fdopen(video_fd, "wb");
+  } else {
+    capture_file = fopen(filename, "wb");
+  }
+  if (!capture_file) {
+    printf("Failed to open capture output: %s\n", filename);
+    return false;
+  }
+  setvbuf(capture_file, stream_buffer, _IOFBF, sizeof(stream_buffer));
+
+  capture_format = format;
+  if (format == CAPTURE_Y4M) {
+    fprintf(capture_file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n", GBA_SCREEN_WIDTH,
+            GBA_SCREEN_HEIGHT, GBA_FPS_NUM, GBA_FPS_DEN);
+  }
+
+  slot_full[0] = slot_full[1] = false;
+  produce_idx = 0;
+  stopping = false;
+  frames_written = 0;
+  if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+    printf("Failed to start capture writer thread\n");
+    fclose(capture_file);
+    capture_file = NULL;
+    return false;
+  }
+
+  printf("[Capture] Streaming %s to %s\n", format == CAPTURE_Y4M ? "Y4M" : "raw RGBA",
+         filename);
+  return true;
+}
+
+void capture_frame(const u32 *framebuffer) {
+  if (!capture_file) return;
+
+  pthread_mutex_lock(&slot_lock);
+  while (slot_full[produce_idx]) {
+    pthread_cond_wait(&slot_freed, &slot_lock);
+  }
+  pthread_mutex_unlock(&slot_lock);
+
+  // The writer never touches a slot that is not marked full
+  memcpy(slots[produce_idx], framebuffer, sizeof(slots[0]));
+
+  pthread_mutex_lock(&slot_lock);
+  slot_full[produce_idx] = true;
+  pthread_cond_signal(&slot_filled);
+  pthread_mutex_unlock(&slot_lock);
+  produce_idx ^= 1;
+}
+
+void capture_close(void) {
+  if (!capture_file) return;
+
+  pthread_mutex_lock(&slot_lock);
+  stopping = true;
+  pthread_cond_signal(&slot_filled);
+  pthread_mutex_unlock(&slot_lock);
+  pthread_join(writer_thread, NULL);
+
+  fclose(capture_file);
+  capture_file = NULL;
+  fprintf(stderr, "[Capture] %llu frames written\n", (unsigned long long)frames_written);
+}
+
+bool capture_active(void) { return capture_file != NULL; }
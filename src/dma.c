@@ -0,0 +1,215 @@
+#include "../include/dma.h"
+#include "../include/apu.h"
+#include "../include/backup.h"
+#include "../include/io.h"
+#include "../include/memory.h"
+#include "../include/stats.h"
+#include <string.h>
+
+typedef struct {
+  u32 src, dst; // Internal address registers
+  u32 count;
+  u16 control;
+  bool enabled;
+} DmaChannel;
+
+static DmaChannel dma[4];
+static int stall_cycles;
+
+static inline u32 reg_base(int ch) { return 0xB0 + ch * 12; }
+
+// Internal address widths: DMA0 can't read ROM, only DMA3 can write it
+static const u32 src_mask[4] = {0x07FFFFFF, 0x0FFFFFFF, 0x0FFFFFFF, 0x0FFFFFFF};
+static const u32 dst_mask[4] = {0x07FFFFFF, 0x07FFFFFF, 0x07FFFFFF, 0x0FFFFFFF};
+
+static void latch_count(int ch) {
+  u16 cnt_l = *(u16 *)&memory_get_io()[reg_base(ch) + 8];
+  u32 count = (ch == 3) ? cnt_l : (cnt_l & 0x3FFF);
+  if (count == 0) count = (ch == 3) ? 0x10000 : 0x4000;
+  dma[ch].count = count;
+}
+
+void dma_init(void) {
+  memset(dma, 0, sizeof(dma));
+  stall_cycles = 0;
+}
+
+int dma_take_cycles(void) {
+  int c = stall_cycles;
+  stall_cycles = 0;
+  return c;
+}
+
+// 2N + 2(n-1)S + 2I
+static void charge(u32 src, u32 dst, u32 count, bool is_32) {
+  stall_cycles += 2;
+  stall_cycles += memory_access_cycles(src, is_32, false) + memory_access_cycles(dst, is_32, false);
+  stall_cycles += (count - 1) *
+                  (memory_access_cycles(src, is_32, true) + memory_access_cycles(dst, is_32, true));
+}
+
+static void transfer(int ch) {
+  DmaChannel *d = &dma[ch];
+  bool is_32 = (d->control >> 10) & 1;
+  int step = is_32 ? 4 : 2;
+  int dst_adj = (d->control >> 5) & 3;
+  int src_adj = (d->control >> 7) & 3;
+  // Increment+reload (3) increments during the transfer; source mode 3 is
+  // prohibited and behaves as increment
+  int src_step = (src_adj == 1) ? -step : (src_adj == 2) ? 0 : step;
+  int dst_step = (dst_adj == 1) ? -step : (dst_adj == 2) ? 0 : step;
+
+  u32 count = d->count;
+  u32 src = d->src & ~(step - 1);
+  u32 dst = d->dst & ~(step - 1);
+  u32 bytes = count * step;
+  STATS_ADD(dma_bytes[ch], bytes);
+  charge(src, dst, count, is_32);
+  if ((dst >> 24) == 0x0D) backup_eeprom_hint(count);
+
+  u8 *dp = (dst_step > 0) ? memory_region_ptr(dst, bytes, true) : NULL;
+  u8 *sp = NULL;
+  if (dp && src_step > 0 && (sp = memory_region_ptr(src, bytes, false))) {
+    // Block copy (EWRAM->VRAM, ROM->IWRAM, ...). Hardware copies unit by
+    // unit in ascending order, so a destination just ahead of the source
+    // re-reads units already written and repeats the leading ones.
+    if (sp < dp && dp < sp + bytes) {
+      if (is_32) {
+        for (u32 i = 0; i < count; i++) ((u32 *)dp)[i] = ((u32 *)sp)[i];
+      } else {
+        for (u32 i = 0; i < count; i++) ((u16 *)dp)[i] = ((u16 *)sp)[i];
+      }
+    } else {
+      memmove(dp, sp, bytes);
+    }
+  } else if (dp && src_step == 0 && (sp = memory_region_ptr(src, step, false))) {
+    // Fill from a fixed source
+    if (is_32) {
+      u32 v = *(u32 *)sp;
+      if ((v & 0xFF) * 0x01010101u == v) {
+        memset(dp, v & 0xFF, bytes);
+      } else {
+        u32 *p = (u32 *)dp;
+        for (u32 i = 0; i < count; i++) p[i] = v;
+      }
+    } else {
+      u16 v = *(u16 *)sp;
+      u16 *p = (u16 *)dp;
+      for (u32 i = 0; i < count; i++) p[i] = v;
+    }
+  } else {
+    // IO destinations, decrementing or region-crossing transfers.
+    // Already charged above, so the bus accesses don't bill the CPU.
+    int saved = bus_cycles;
+    u32 s = src, t = dst;
+    for (u32 i = 0; i < count; i++) {
+      if (is_32) bus_write32(t, bus_read32(s));
+      else bus_write16(t, bus_read16(s));
+      s += src_step;
+      t += dst_step;
+    }
+    bus_cycles = saved;
+  }
+
+  d->src = src + src_step * count;
+  d->dst = dst + dst_step * count;
+}
+
+static void finish(int ch) {
+  DmaChannel *d = &dma[ch];
+  u8 *io = memory_get_io();
+  int timing = (d->control >> 12) & 3;
+
+  if ((d->control >> 14) & 1) {
+    io_request_irq(1 << (8 + ch)); // DMA0=8 .. DMA3=11
+  }
+
+  if (((d->control >> 9) & 1) && timing != 0) {
+    // Repeat: reload the count, and the destination for mode 3
+    latch_count(ch);
+    if (((d->control >> 5) & 3) == 3) {
+      d->dst = *(u32 *)&io[reg_base(ch) + 4] & dst_mask[ch];
+    }
+  } else {
+    d->control &= ~0x8000;
+    d->enabled = false;
+    *(u16 *)&io[reg_base(ch) + 10] = d->control;
+  }
+}
+
+static void run(int ch) {
+  transfer(ch);
+  finish(ch);
+}
+
+void dma_write_control(int ch, u16 control_val) {
+  DmaChannel *d = &dma[ch];
+  bool was_enabled = d->enabled;
+  d->control = control_val;
+  d->enabled = (control_val >> 15) & 1;
+  if (!d->enabled || was_enabled) return;
+
+  // Rising edge of the enable bit latches the source/destination/count
+  u8 *io = memory_get_io();
+  d->src = *(u32 *)&io[reg_base(ch)] & src_mask[ch];
+  d->dst = *(u32 *)&io[reg_base(ch) + 4] & dst_mask[ch];
+  latch_count(ch);
+
+  if (((control_val >> 12) & 3) == 0) run(ch);
+}
+
+static void run_timing(int timing) {
+  // Lower channels have priority
+  for (int ch = 0; ch < 4; ch++) {
+    if (dma[ch].enabled && ((dma[ch].control >> 12) & 3) == timing) run(ch);
+  }
+}
+
+void dma_on_vblank(void) { run_timing(1); }
+
+void dma_on_hblank(void) { run_timing(2); }
+
+void dma_on_video_capture(int vcount) {
+  DmaChannel *d = &dma[3];
+  if (!d->enabled || ((d->control >> 12) & 3) != 3) return;
+  if (vcount >= 2 && vcount < 162) {
+    run(3);
+  } else if (vcount == 162) {
+    // Capture ends after line 161
+    d->control &= ~0x8000;
+    d->enabled = false;
+    *(u16 *)&memory_get_io()[reg_base(3) + 10] = d->control;
+  }
+}
+
+void dma_sound_request(u32 fifo_addr) {
+  for (int ch = 1; ch <= 2; ch++) {
+    DmaChannel *d = &dma[ch];
+    if (!d->enabled || ((d->control >> 12) & 3) != 3 || d->dst != fifo_addr) continue;
+
+    // Sound DMA always moves 4 words to the fixed FIFO address,
+    // ignoring the word count and destination control
+    int src_adj = (d->control >> 7) & 3;
+    int fifo = (fifo_addr == APU_FIFO_A) ? 0 : 1;
+    u32 src = d->src & ~3;
+    charge(src, fifo_addr, 4, true);
+    STATS_ADD(dma_bytes[ch], 16);
+    int saved = bus_cycles;
+    for (int i = 0; i < 4; i++) {
+      apu_fifo_write32(fifo, bus_read32(src));
+      if (src_adj != 1 && src_adj != 2) src += 4;
+      else if (src_adj == 1) src -= 4;
+    }
+    bus_cycles = saved;
+    d->src = src;
+
+    if ((d->control >> 14) & 1) {
+      io_request_irq(1 << (8 + ch));
+    }
+    if (!((d->control >> 9) & 1)) {
+      d->control &= ~0x8000;
+      d->enabled = false;
+      *(u16 *)&memory_get_io()[reg_base(ch) + 10] = d->control;
+    }
+  }
+}
@@ -0,0 +1,337 @@
+#include "../include/frame_hash.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// XXH3 64-bit (seed 0, default secret)
+// Reference: https://github.com/Cyan4973/xxHash (XXH3_64bits)
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_SECRET_SIZE 192
+#define XXH_STRIPE_LEN 64
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_SECRET_LASTACC_START 7
+#define XXH_SECRET_MERGEACCS_START 11
+#define XXH_MIDSIZE_STARTOFFSET 3
+#define XXH_MIDSIZE_LASTOFFSET 17
+#define XXH_SECRET_SIZE_MIN 136
+
+static const u8 xxh3_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// Little-endian loads (GBA and every supported host are little-endian)
+static inline u32 read32(const u8 *p) {
+  u32 v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline u64 read64(const u8 *p) {
+  u64 v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline u64 rotl64(u64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline u32 swap32(u32 x) {
+  return ((x << 24) & 0xFF000000) | ((x << 8) & 0x00FF0000) |
+         ((x >> 8) & 0x0000FF00) | ((x >> 24) & 0x000000FF);
+}
+
+static inline u64 swap64(u64 x) {
+  return ((u64)swap32((u32)x) << 32) | swap32((u32)(x >> 32));
+}
+
+// 64x64 -> 128 multiply, low half XOR high half
+static inline u64 mul128_fold64(u64 lhs, u64 rhs) {
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 product = (unsigned __int128)lhs * rhs;
+  return (u64)product ^ (u64)(product >> 64);
+#else
+  u64 lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  u64 hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  u64 lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  u64 hi_hi = (lhs >> 32) * (rhs >> 32);
+  u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  u64 upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  u64 lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return lower ^ upper;
+#endif
+}
+
+static u64 xxh64_avalanche(u64 h) {
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+static u64 xxh3_avalanche(u64 h) {
+  h ^= h >> 37;
+  h *= XXH_PRIME_MX1;
+  h ^= h >> 32;
+  return h;
+}
+
+static u64 xxh3_rrmxmx(u64 h, u64 len) {
+  h ^= rotl64(h, 49) ^ rotl64(h, 24);
+  h *= XXH_PRIME_MX2;
+  h ^= (h >> 35) + len;
+  h *= XXH_PRIME_MX2;
+  return h ^ (h >> 28);
+}
+
+static inline u64 xxh3_mix16(const u8 *in, const u8 *secret) {
+  return mul128_fold64(read64(in) ^ read64(secret),
+                       read64(in + 8) ^ read64(secret + 8));
+}
+
+static u64 xxh3_len_0to16(const u8 *in, size_t len) {
+  const u8 *s = xxh3_secret;
+  if (len > 8) {
+    u64 bitflip1 = read64(s + 24) ^ read64(s + 32);
+    u64 bitflip2 = read64(s + 40) ^ read64(s + 48);
+    u64 lo = read64(in) ^ bitflip1;
+    u64 hi = read64(in + len - 8) ^ bitflip2;
+    u64 acc = len + swap64(lo) + hi + mul128_fold64(lo, hi);
+    return xxh3_avalanche(acc);
+  }
+  if (len >= 4) {
+    u32 in1 = read32(in);
+    u32 in2 = read32(in + len - 4);
+    u64 bitflip = read64(s + 8) ^ read64(s + 16);
+    u64 keyed = (in2 + ((u64)in1 << 32)) ^ bitflip;
+    return xxh3_rrmxmx(keyed, len);
+  }
+  if (len > 0) {
+    u32 combined = ((u32)in[0] << 16) | ((u32)in[len >> 1] << 24) |
+                   (u32)in[len - 1] | ((u32)len << 8);
+    u64 bitflip = read32(s) ^ read32(s + 4);
+    return xxh64_avalanche((u64)combined ^ bitflip);
+  }
+  return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+}
+
+static u64 xxh3_len_17to128(const u8 *in, size_t len) {
+  const u8 *s = xxh3_secret;
+  u64 acc = len * XXH_PRIME64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += xxh3_mix16(in + 48, s + 96);
+        acc += xxh3_mix16(in + len - 64, s + 112);
+      }
+      acc += xxh3_mix16(in + 32, s + 64);
+      acc += xxh3_mix16(in + len - 48, s + 80);
+    }
+    acc += xxh3_mix16(in + 16, s + 32);
+    acc += xxh3_mix16(in + len - 32, s + 48);
+  }
+  acc += xxh3_mix16(in, s);
+  acc += xxh3_mix16(in + len - 16, s + 16);
+  return xxh3_avalanche(acc);
+}
+
+static u64 xxh3_len_129to240(const u8 *in, size_t len) {
+  const u8 *s = xxh3_secret;
+  u64 acc = len * XXH_PRIME64_1;
+  int rounds = (int)len / 16;
+  for (int i = 0; i < 8; i++) {
+    acc += xxh3_mix16(in + 16 * i, s + 16 * i);
+  }
+  u64 acc_end = xxh3_mix16(in + len - 16, s + XXH_SECRET_SIZE_MIN - XXH_MIDSIZE_LASTOFFSET);
+  acc = xxh3_avalanche(acc);
+  for (int i = 8; i < rounds; i++) {
+    acc_end += xxh3_mix16(in + 16 * i, s + 16 * (i - 8) + XXH_MIDSIZE_STARTOFFSET);
+  }
+  return xxh3_avalanche(acc + acc_end);
+}
+
+// One 64-byte stripe into the 8 lanes. Written as a plain lane loop so the
+// compiler can vectorize it (SSE2/AVX2/NEON) without intrinsics.
+static inline void xxh3_accumulate_512(u64 *acc, const u8 *in, const u8 *secret) {
+  for (int i = 0; i < 8; i++) {
+    u64 data_val = read64(in + 8 * i);
+    u64 data_key = data_val ^ read64(secret + 8 * i);
+    acc[i ^ 1] += data_val;
+    acc[i] += (u64)(u32)data_key * (data_key >> 32);
+  }
+}
+
+static inline void xxh3_scramble(u64 *acc, const u8 *secret) {
+  for (int i = 0; i < 8; i++) {
+    u64 a = acc[i];
+    a ^= a >> 47;
+    a ^= read64(secret + 8 * i);
+    a *= XXH_PRIME32_1;
+    acc[i] = a;
+  }
+}
+
+static u64 xxh3_hash_long(const u8 *in, size_t len) {
+  u64 acc[8] = {XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+                XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1};
+  const u8 *s = xxh3_secret;
+  const size_t stripes_per_block = (XXH_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE;
+  const size_t block_len = XXH_STRIPE_LEN * stripes_per_block;
+  const size_t blocks = (len - 1) / block_len;
+
+  for (size_t n = 0; n < blocks; n++) {
+    const u8 *block = in + n * block_len;
+    for (size_t st = 0; st < stripes_per_block; st++) {
+      xxh3_accumulate_512(acc, block + st * XXH_STRIPE_LEN, s + st * XXH_SECRET_CONSUME_RATE);
+    }
+    xxh3_scramble(acc, s + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+  }
+
+  // Last partial block
+  size_t stripes = ((len - 1) - block_len * blocks) / XXH_STRIPE_LEN;
+  const u8 *tail = in + blocks * block_len;
+  for (size_t st = 0; st < stripes; st++) {
+    xxh3_accumulate_512(acc, tail + st * XXH_STRIPE_LEN, s + st * XXH_SECRET_CONSUME_RATE);
+  }
+
+  // Last stripe
+  xxh3_accumulate_512(acc, in + len - XXH_STRIPE_LEN,
+                      s + XXH_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START);
+
+  // Merge lanes
+  const u8 *ms = s + XXH_SECRET_MERGEACCS_START;
+  u64 result = len * XXH_PRIME64_1;
+  for (int i = 0; i < 4; i++) {
+    result += mul128_fold64(acc[2 * i] ^ read64(ms + 16 * i),
+                            acc[2 * i + 1] ^ read64(ms + 16 * i + 8));
+  }
+  return xxh3_avalanche(result);
+}
+
+u64 frame_hash_xxh3(const void *data, size_t len) {
+  const u8 *in = (const u8 *)data;
+  if (len <= 16) return xxh3_len_0to16(in, len);
+  if (len <= 128) return xxh3_len_17to128(in, len);
+  if (len <= 240) return xxh3_len_129to240(in, len);
+  return xxh3_hash_long(in, len);
+}
+
+// Golden Set
+
+void golden_init(GoldenSet *set) { memset(set, 0, sizeof(GoldenSet)); }
+
+void golden_free(GoldenSet *set) {
+  free(set->frames);
+  free(set->hashes);
+  golden_init(set);
+}
+
+// Index of the first entry with frames[i] >= frame
+static int golden_find(const GoldenSet *set, u32 frame) {
+  int lo = 0, hi = set->count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (set->frames[mid] < frame) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+void golden_set(GoldenSet *set, u32 frame, u64 hash) {
+  int idx = golden_find(set, frame);
+  if (idx < set->count && set->frames[idx] == frame) {
+    set->hashes[idx] = hash;
+    return;
+  }
+
+  if (set->count == set->capacity) {
+    int new_cap = set->capacity ? set->capacity * 2 : 64;
+    u32 *frames = (u32 *)realloc(set->frames, new_cap * sizeof(u32));
+    u64 *hashes = (u64 *)realloc(set->hashes, new_cap * sizeof(u64));
+    if (frames) set->frames = frames;
+    if (hashes) set->hashes = hashes;
+    if (!frames || !hashes) return;
+    set->capacity = new_cap;
+  }
+
+  // Frames are normally appended in order, so this memmove is usually empty
+  memmove(&set->frames[idx + 1], &set->frames[idx], (set->count - idx) * sizeof(u32));
+  memmove(&set->hashes[idx + 1], &set->hashes[idx], (set->count - idx) * sizeof(u64));
+  set->frames[idx] = frame;
+  set->hashes[idx] = hash;
+  set->count++;
+}
+
+bool golden_lookup(const GoldenSet *set, u32 frame, u64 *hash) {
+  int idx = golden_find(set, frame);
+  if (idx < set->count && set->frames[idx] == frame) {
+    *hash = set->hashes[idx];
+    return true;
+  }
+  return false;
+}
+
+bool golden_load(GoldenSet *set, const char *filename) {
+  FILE *f = fopen(filename, "r");
+  if (!f) {
+    printf("Failed to open golden file: %s\n", filename);
+    return false;
+  }
+
+  char line[128];
+  int line_no = 0;
+  while (fgets(line, sizeof(line), f)) {
+    line_no++;
+    char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+
+    unsigned long frame;
+    unsigned long long hash;
+    if (sscanf(p, "%lu %llx", &frame, &hash) != 2) {
+      printf("Golden file %s:%d: malformed line\n", filename, line_no);
+      fclose(f);
+      return false;
+    }
+    golden_set(set, (u32)frame, (u64)hash);
+  }
+  fclose(f);
+  return true;
+}
+
+bool golden_save(const GoldenSet *set, const char *filename) {
+  FILE *f = fopen(filename, "w");
+  if (!f) {
+    printf("Failed to create golden file: %s\n", filename);
+    return false;
+  }
+  fprintf(f, "# GBA golden frame hashes (XXH3-64 of 240x160 ARGB8888 framebuffer)\n");
+  fprintf(f, "# frame hash\n");
+  for (int i = 0; i < set->count; i++) {
+    fprintf(f, "%u %016llx\n", set->frames[i], (unsigned long long)set->hashes[i]);
+  }
+  fclose(f);
+  return true;
+}
@@ -0,0 +1,151 @@
+#include "../include/io.h"
+#include "../include/apu.h"
+#include "../include/dma.h"
+#include "../include/memory.h"
+#include "../include/timer.h"
+
+#define IO_HALFWORDS 0x200
+
+static IoReadHandler read_table[IO_HALFWORDS];
+static IoWriteHandler write_table[IO_HALFWORDS];
+static u16 write_mask[IO_HALFWORDS];
+static int halt_request;
+
+u16 io_irq_pending;
+bool io_irq_master;
+
+static inline u16 *reg(u32 offset) { return (u16 *)&memory_get_io()[offset]; }
+
+// Store the writable bits the CPU wrote
+static inline void store(u32 offset, u16 value, u16 mask) {
+  u16 m = mask & write_mask[offset >> 1];
+  *reg(offset) = (*reg(offset) & ~m) | (value & m);
+}
+
+static u16 read_raw(u32 offset) { return *reg(offset); }
+
+static void write_raw(u32 offset, u16 value, u16 mask) { store(offset, value, mask); }
+
+// Sound: the APU works on bytes
+static void write_sound(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask);
+  if (mask & 0x00FF) apu_io_write(offset, value & 0xFF, 1);
+  if (mask & 0xFF00) apu_io_write(offset + 1, value >> 8, 1);
+}
+
+// DMAxCNT_H: enable edge latches and may start the transfer
+static void write_dma_control(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask);
+  dma_write_control((offset - 0xBA) / 12, *reg(offset));
+}
+
+// TMxCNT_L reads the live counter; writes set the reload value
+static u16 read_timer_counter(u32 offset) { return timer_read_counter((offset - 0x100) >> 2); }
+
+static void write_timer(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask);
+  timer_io_write(offset, 2);
+}
+
+static void update_irq(void) {
+  io_irq_pending = *reg(0x200) & *reg(0x202) & 0x3FFF;
+  io_irq_master = *reg(0x208) & 1;
+}
+
+void io_request_irq(u16 mask) {
+  *reg(0x202) |= mask;
+  update_irq();
+}
+
+// IE / IME
+static void write_irq_control(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask);
+  update_irq();
+}
+
+// IF: writing 1 acknowledges
+static void write_if(u32 offset, u16 value, u16 mask) {
+  *reg(offset) &= ~(value & mask);
+  update_irq();
+}
+
+static void write_waitcnt(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask);
+  memory_update_waitstates();
+}
+
+// POSTFLG (low byte) / HALTCNT (high byte, write-only)
+static void write_haltcnt(u32 offset, u16 value, u16 mask) {
+  store(offset, value, mask & 0x00FF);
+  if (mask & 0xFF00) halt_request = (value & 0x8000) ? 2 : 1;
+}
+
+static void map(u32 offset, IoReadHandler r, IoWriteHandler w, u16 wmask) {
+  read_table[offset >> 1] = r;
+  write_table[offset >> 1] = w;
+  write_mask[offset >> 1] = wmask;
+}
+
+void io_init(void) {
+  for (int i = 0; i < IO_HALFWORDS; i++) map(i * 2, read_raw, write_raw, 0xFFFF);
+
+  map(0x004, read_raw, write_raw, 0xFF38); // DISPSTAT: status bits read-only
+  map(0x006, read_raw, write_raw, 0x0000); // VCOUNT
+
+  for (u32 o = 0x060; o < 0x0A8; o += 2) map(o, read_raw, write_sound, 0xFFFF);
+  map(0x084, read_raw, write_sound, 0x0080); // SOUNDCNT_X: only master enable
+
+  for (int ch = 0; ch < 4; ch++) {
+    map(0x0BA + ch * 12, read_raw, write_dma_control, ch == 3 ? 0xFFE0 : 0xF7E0);
+  }
+
+  for (int t = 0; t < 4; t++) {
+    map(0x100 + t * 4, read_timer_counter, write_timer, 0xFFFF);
+    map(0x102 + t * 4, read_raw, write_timer, 0x00C7);
+  }
+
+  map(0x130, read_raw, write_raw, 0x0000); // KEYINPUT
+  map(0x200, read_raw, write_irq_control, 0x3FFF);
+  map(0x202, read_raw, write_if, 0x3FFF);
+  map(0x208, read_raw, write_irq_control, 0x0001);
+  map(0x204, read_raw, write_waitcnt, 0x5FFF);
+  map(0x300, read_raw, write_haltcnt, 0x0001);
+
+  halt_request = 0;
+  update_irq();
+}
+
+int io_take_halt_request(void) {
+  int r = halt_request;
+  halt_request = 0;
+  return r;
+}
+
+u16 io_read16(u32 offset) {
+  offset &= 0x3FE;
+  return read_table[offset >> 1](offset);
+}
+
+u8 io_read8(u32 offset) { return io_read16(offset) >> ((offset & 1) * 8); }
+
+u32 io_read32(u32 offset) {
+  offset &= 0x3FC;
+  return io_read16(offset) | ((u32)io_read16(offset + 2) << 16);
+}
+
+void io_write16(u32 offset, u16 value) {
+  offset &= 0x3FE;
+  write_table[offset >> 1](offset, value, 0xFFFF);
+}
+
+void io_write8(u32 offset, u8 value) {
+  int shift = (offset & 1) * 8;
+  u32 aligned = offset & 0x3FE;
+  write_table[aligned >> 1](aligned, (u16)(value << shift), (u16)(0xFF << shift));
+}
+
+void io_write32(u32 offset, u32 value) {
+  offset &= 0x3FC;
+  io_write16(offset, value & 0xFFFF);
+  io_write16(offset + 2, value >> 16);
+}
@@ -6,7 +6,20 @@
 #include "../include/cpu.h"
 #include "../include/memory.h"
 #include "../include/ppu.h"
+#include "../include/frame_hash.h"
+#include "../include/capture.h"
+#include "../include/png.h"
+#include "../include/apu.h"
+#include "../include/scheduler.h"
+#include "../include/timer.h"
+#include "../include/dma.h"
+#include "../include/backup.h"
+#include "../include/bios.h"
+#include "../include/stats.h"
+#include "../include/profiler.h"
+#include "../include/trace.h"
 #include <stdio.h>
+#include <string.h>
 
 #ifdef USE_SDL
 #include <SDL.h>
@@ -19,6 +32,7 @@ typedef struct { int type; } SDL_Event;
 typedef struct { int sym; } SDL_Keysym;
 typedef struct { SDL_Keysym keysym; } SDL_KeyboardEvent;
 #define SDL_INIT_VIDEO 0
+#define SDL_INIT_AUDIO 0
 #define SDL_WINDOWPOS_UNDEFINED 0
 #define SDL_WINDOW_SHOWN 0
 #define SDL_RENDERER_ACCELERATED 0
@@ -39,8 +53,155 @@ typedef struct { SDL_Keysym keysym; } SDL_KeyboardEvent;
 #define SDLK_s 0
 #endif
 
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] [rom.gba]\n", prog);
+  printf("  --frames N            Stop after N frames\n");
+  printf("  --hash                Print the XXH3-64 hash of every frame\n");
+  printf("  --hash-interval N     Hash every Nth frame (default 1)\n");
+  printf("  --golden-record FILE  Write frame hashes to a golden file\n");
+  printf("  --golden-check FILE   Compare frame hashes against a golden file;\n");
+  printf("                        screenshots are only written on mismatch\n");
+  printf("  --capture FILE        Stream every frame to FILE ('-' for stdout)\n");
+  printf("  --capture-format F    y4m (default) or raw (RGBA8888)\n");
+  printf("  --wav FILE            Write 48 kHz stereo audio to a WAV file\n");
+  printf("  --save FILE           Backup memory file (default: ROM name with .sav)\n");
+  printf("  --bios FILE           Boot a 16KB BIOS image instead of HLE\n");
+  printf("  --bios-hle LIST       SWIs kept in HLE with --bios: comma-separated\n");
+  printf("                        hex numbers or 'none' (default 6,7,C,11,12)\n");
+  printf("  --profile FILE        Sample the guest PC and write folded call stacks\n");
+  printf("  --profile-interval N  Cycles between samples (default 1024)\n");
+  printf("  --symbols FILE        ELF or .map/nm symbols for --profile\n");
+  printf("  --trace FILE          Binary per-instruction trace (read with gba_trace)\n");
+  printf("  --stats FILE          Write hot-path counters as JSON at exit and on\n");
+  printf("                        SIGUSR1 (needs a make STATS=1 build)\n");
+}
+
+#ifdef USE_SDL
+static void audio_callback(void *userdata, Uint8 *stream, int len) {
+  s16 *out = (s16 *)stream;
+  int frames = len / 4;
+  int got = apu_read_samples(out, frames);
+  // Underrun: pad with silence
+  memset(out + got * 2, 0, (frames - got) * 4);
+}
+#endif
+
 int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
+
+  char *rom_filename = "test.gba";
+  int max_frames = 0; // 0 = unlimited
+  bool print_hash = false;
+  int hash_interval = 1;
+  const char *golden_record_file = NULL;
+  const char *golden_check_file = NULL;
+  const char *capture_file = NULL;
+  CaptureFormat capture_format = CAPTURE_Y4M;
+  const char *wav_file = NULL;
+  const char *save_file = NULL;
+  const char *bios_file = NULL;
+  const char *stats_file = NULL;
+  const char *profile_file = NULL;
+  const char *symbols_file = NULL;
+  const char *trace_file = NULL;
+  int profile_interval = 1024;
+  u64 bios_accel = BIOS_ACCEL_DEFAULT;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      max_frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--hash") == 0) {
+      print_hash = true;
+    } else if (strcmp(argv[i], "--hash-interval") == 0 && i + 1 < argc) {
+      hash_interval = atoi(argv[++i]);
+      if (hash_interval < 1) hash_interval = 1;
+    } else if (strcmp(argv[i], "--golden-record") == 0 && i + 1 < argc) {
+      golden_record_file = argv[++i];
+    } else if (strcmp(argv[i], "--golden-check") == 0 && i + 1 < argc) {
+      golden_check_file = argv[++i];
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capture_file = argv[++i];
+    } else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+      const char *fmt = argv[++i];
+      if (strcmp(fmt, "y4m") == 0) {
+        capture_format = CAPTURE_Y4M;
+      } else if (strcmp(fmt, "raw") == 0) {
+        capture_format = CAPTURE_RAW;
+      } else {
+        printf("Unknown capture format: %s\n", fmt);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+      wav_file = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+      save_file = argv[++i];
+    } else if (strcmp(argv[i], "--bios") == 0 && i + 1 < argc) {
+      bios_file = argv[++i];
+    } else if (strcmp(argv[i], "--bios-hle") == 0 && i + 1 < argc) {
+      const char *list = argv[++i];
+      bios_accel = 0;
+      while (strcmp(list, "none") != 0 && *list) {
+        char *end;
+        unsigned long n = strtoul(list, &end, 16);
+        if (end == list || n >= 64) {
+          printf("Invalid --bios-hle list: %s\n", argv[i]);
+          return 1;
+        }
+        bios_accel |= 1ull << n;
+        list = (*end == ',') ? end + 1 : end;
+      }
+    } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      profile_file = argv[++i];
+    } else if (strcmp(argv[i], "--profile-interval") == 0 && i + 1 < argc) {
+      profile_interval = atoi(argv[++i]);
+      if (profile_interval < 1) profile_interval = 1;
+    } else if (strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+      symbols_file = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      stats_file = argv[++i];
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      printf("Unknown option: %s\n", argv[i]);
+      print_usage(argv[0]);
+      return 1;
+    } else {
+      rom_filename = argv[i];
+    }
+  }
+
+  if (stats_file) {
+#ifdef GBA_STATS
+    stats_install(stats_file);
+#else
+    printf("--stats ignored: rebuild with make STATS=1\n");
+#endif
+  }
+
+  if (profile_file) {
+    if (symbols_file && !profiler_load_symbols(symbols_file)) {
+      return 1;
+    }
+    profiler_init(profile_interval);
+  }
+  GoldenSet golden, golden_recorded;
+  golden_init(&golden);
+  golden_init(&golden_recorded);
+  if (golden_check_file && !golden_load(&golden, golden_check_file)) {
+    return 1;
+  }
+  // Open capture first: streaming to stdout moves console output to stderr
+  if (capture_file && !capture_open(capture_file, capture_format)) {
+    return 1;
+  }
+
+  bool hashing = print_hash || golden_record_file || golden_check_file;
+  int golden_checked = 0;
+  int golden_mismatches = 0;
+
 #ifdef USE_SDL
   printf("Starting GBA Emulator (SDL)\n");
 #else
@@ -48,7 +209,7 @@ int main(int argc, char *argv[]) {
 #endif
 
 #ifdef USE_SDL
-  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
     printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
     return 1;
   }
@@ -75,37 +236,86 @@ int main(int argc, char *argv[]) {
   // Hardware Initialization
   ARM7TDMI cpu;
   cpu_init(&cpu);
+  scheduler_init();
   memory_init();
+  timer_init();
+  apu_init();
   ppu_init(renderer, texture);
 
-  char *rom_filename = "test.gba";
-  if (argc > 1) {
-    rom_filename = argv[1];
+  if (wav_file && !apu_wav_open(wav_file)) {
+    return 1;
   }
+#ifdef USE_SDL
+  // Live audio pulls from the APU ring buffer; a WAV file takes priority
+  SDL_AudioDeviceID audio_dev = 0;
+  if (!wav_file) {
+    SDL_AudioSpec want = {0};
+    want.freq = APU_OUTPUT_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = 1024;
+    want.callback = audio_callback;
+    audio_dev = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+    if (audio_dev) SDL_PauseAudioDevice(audio_dev, 0);
+    else printf("Audio device unavailable: %s\n", SDL_GetError());
+  }
+#endif
 
   if (!memory_load_rom(rom_filename)) {
     printf("Failed to load %s. Exiting.\n", rom_filename);
     return 1;
   }
 
-  // Direct Boot Setup
-  cpu.r[REG_PC] = 0x08000000;
-  cpu.cpsr = 0x1F; // System Mode
-  cpu.r[REG_SP] = 0x03007F00; // Stack Pointer
-  printf("Direct Boot: PC=%08X, CPSR=%08X, SP=%08X\n", cpu.r[REG_PC], cpu.cpsr,
-         cpu.r[REG_SP]);
+  // Backup memory: game.gba -> game.sav unless --save is given
+  char save_path[1024];
+  if (save_file) {
+    snprintf(save_path, sizeof(save_path), "%s", save_file);
+  } else {
+    snprintf(save_path, sizeof(save_path), "%s", rom_filename);
+    char *dot = strrchr(save_path, '.');
+    char *slash = strrchr(save_path, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(save_path, ".sav", sizeof(save_path) - strlen(save_path) - 1);
+  }
+  BackupType backup = backup_detect(rom_memory, memory_rom_size());
+  if (!backup_init(backup, save_path)) {
+    return 1;
+  }
+
+  if (bios_file) {
+    // Reset vector: the BIOS sets up stacks, runs the intro and jumps to ROM
+    if (!bios_load_file(bios_file)) {
+      return 1;
+    }
+    bios_set_accelerators(bios_accel);
+    cpu_set_cpsr(&cpu, 0xD3); // Supervisor, IRQ/FIQ masked
+    cpu.r[REG_PC] = 0x00000000;
+    printf("BIOS Boot: PC=%08X, CPSR=%08X\n", cpu.r[REG_PC], cpu.cpsr);
+  } else {
+    // Direct Boot Setup
+    cpu.r[REG_PC] = 0x08000000;
+    cpu.cpsr = 0x1F; // System Mode
+    cpu.r[REG_SP] = 0x03007F00; // Stack Pointer
+    bios_init(&cpu);            // IRQ stub and banked stacks
+    printf("Direct Boot: PC=%08X, CPSR=%08X, SP=%08X\n", cpu.r[REG_PC], cpu.cpsr,
+           cpu.r[REG_SP]);
+  }
+  if (trace_file && !trace_open(trace_file)) {
+    return 1;
+  }
 
   bool quit = false;
 #ifdef USE_SDL
   SDL_Event e;
 #endif
 
-  // Headless loop limit
-  int max_cycles = 50000000;
+  // Headless loop limit (an explicit --frames count replaces it)
+  u64 max_cycles = max_frames ? UINT64_MAX : 50000000;
 #ifdef USE_SDL
   (void)max_cycles; // Unused in SDL mode (runs until quit)
 #endif
-  int total_cycles = 0;
+  u64 total_cycles = 0;
+  int frame_count = 0;
 
   while (!quit) {
 #ifdef USE_SDL
@@ -132,8 +342,11 @@ int main(int argc, char *argv[]) {
 
     while (cycles_run < cycles_per_frame) {
       int cycles = cpu_step(&cpu);
+      cycles += dma_take_cycles(); // CPU stalled during transfers
       ppu_update(cycles);
-      timer_step(cycles);
+      scheduler_advance(cycles);
+      apu_step(cycles);
+      if (profiler_enabled) profiler_sample(&cpu, cycles);
       cycles_run += cycles;
       total_cycles += cycles;
 #ifndef USE_SDL
@@ -166,15 +379,47 @@ int main(int argc, char *argv[]) {
 #else
     // Headless Render (Mock)
     ppu_update_texture(NULL); 
-    
-    static int frame_count = 0;
+#endif
     frame_count++;
-    
+    apu_wav_drain();
+    stats_poll();
+
+    if (capture_active()) {
+        capture_frame(ppu_get_framebuffer());
+    }
+
+    if (hashing && frame_count % hash_interval == 0) {
+        u64 hash = ppu_frame_hash();
+        if (print_hash) {
+            printf("[Hash] Frame %d: %016llx\n", frame_count, (unsigned long long)hash);
+        }
+        if (golden_record_file) {
+            golden_set(&golden_recorded, frame_count, hash);
+        }
+        u64 expected;
+        if (golden_check_file && golden_lookup(&golden, frame_count, &expected)) {
+            golden_checked++;
+            if (expected != hash) {
+                golden_mismatches++;
+                printf("[Golden] Frame %d mismatch: expected %016llx, got %016llx\n",
+                       frame_count, (unsigned long long)expected, (unsigned long long)hash);
+                char filename[32];
+                sprintf(filename, "mismatch_%04d.png", frame_count);
+                ppu_save_screenshot(filename);
+            }
+        }
+    }
+
+    if (max_frames && frame_count >= max_frames) quit = true;
+
+#ifndef USE_SDL
     // Save screenshot every 60 frames (1 second)
-    if (frame_count % 60 == 0) {
+    // Golden-check runs only write images on mismatch, and a capture stream
+    // already records every frame
+    if (!golden_check_file && !capture_active() && frame_count % 60 == 0) {
         char filename[32];
-        sprintf(filename, "screenshot_%04d.ppm", frame_count);
-        ppu_save_screenshot(filename);
+        sprintf(filename, "screenshot_%04d.png", frame_count);
+        ppu_save_screenshot_async(filename);
         
         // Diagnostic Log
         u8 *io = memory_get_io();
@@ -199,16 +444,40 @@ int main(int argc, char *argv[]) {
   }
 
 #ifdef USE_SDL
+  if (audio_dev) SDL_CloseAudioDevice(audio_dev);
   SDL_DestroyTexture(texture);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
 #endif
   
+  if (profile_file) profiler_write(profile_file);
+  trace_close();
+  capture_close();
+  apu_wav_close();
+  backup_close();
+
 #ifndef USE_SDL
-  ppu_save_screenshot("screenshot.ppm");
+  if (!golden_check_file) ppu_save_screenshot("screenshot.png");
 #endif
+  png_async_flush();
+
+  int exit_code = 0;
+  if (golden_record_file) {
+    if (golden_save(&golden_recorded, golden_record_file)) {
+      printf("[Golden] Recorded %d frame hashes to %s\n", golden_recorded.count, golden_record_file);
+    } else {
+      exit_code = 1;
+    }
+  }
+  if (golden_check_file) {
+    printf("[Golden] Checked %d frames against %s: %d mismatches\n",
+           golden_checked, golden_check_file, golden_mismatches);
+    if (golden_mismatches > 0 || golden_checked < golden.count) exit_code = 1;
+  }
+  golden_free(&golden);
+  golden_free(&golden_recorded);
   
   printf("Emulation finished (Headless limit reached or Quit).\n");
-  return 0;
+  return exit_code;
 }
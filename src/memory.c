@@ -1,4 +1,9 @@
 #include "../include/memory.h"
+#include "../include/dma.h"
+#include "../include/io.h"
+#include "../include/backup.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
 #include <stdio.h>
 
 #include <string.h>
@@ -6,74 +11,139 @@
 #include <stdlib.h> // For malloc
 
 // Memory map placeholders
-static u8 bios[0x4000];
-static u8 wram_on_board[0x40000];
-static u8 wram_on_chip[0x8000];
-static u8 io_regs[0x400];
-static u8 pal_ram[0x400];
-static u8 vram[0x18000]; // 96KB VRAM
-static u8 oam[0x400];    // 1KB OAM
+// Word aligned so the masked 16/32-bit accesses below are aligned host loads
+#define ALIGNED __attribute__((aligned(4)))
+static u8 bios[0x4000] ALIGNED;
+static u8 wram_on_board[0x40000] ALIGNED;
+static u8 wram_on_chip[0x8000] ALIGNED;
+static u8 io_regs[0x400] ALIGNED;
+static u8 pal_ram[0x400] ALIGNED;
+static u8 vram[0x18000] ALIGNED; // 96KB VRAM
+static u8 oam[0x400] ALIGNED;    // 1KB OAM
 // static u32 dummy_rom[1024]; // 4KB dummy ROM - Replacing with real ROM buffer
-u8 *rom_memory = NULL;
-
-// Forward Declaration
-void check_dma(int channel, u16 control_val);
-
-// Timer State
-static u16 timer_counter[4] = {0};
-static u16 timer_reload[4] = {0};
-static double timer_accumulator[4] = {0}; 
-
-// Helper to get prescaler shift: 0=1, 1=64, 2=256, 3=1024
-static int get_prescaler_shift(int setting) {
-    switch (setting) {
-        case 0: return 0; // x1
-        case 1: return 6; // x64
-        case 2: return 8; // x256
-        case 3: return 10; // x1024
+u8 *rom_memory = NULL; // ROM_MAX bytes, open-bus pattern past rom_size
+static u32 rom_size = 0;
+static u8 *rom_buffer = NULL;
+
+// EEPROM sits in the top of ROM space: all of 0x0D for ROMs up to 16MB,
+// only 0x0DFFFF00+ for larger ones
+static inline bool is_eeprom(u32 addr) {
+  if ((addr >> 24) != 0x0D || backup_type() != BACKUP_EEPROM) return false;
+  return rom_size <= 0x01000000 || addr >= 0x0DFFFF00;
+}
+
+// Waitstates
+// Cycles per access indexed by [32-bit][sequential][addr >> 24], rebuilt
+// from WAITCNT so every bus access costs one table lookup.
+static u8 access_cycles[2][2][256];
+static u32 last_access = 0xFFFFFFFF; // For sequential detection
+static u32 last_fetch = 0xFFFFFFFF;  // Opcode stream is tracked separately
+static bool prefetch_enabled = false;
+static int prefetch_credit = 0;      // Cycles the GamePak prefetcher ran ahead
+int bus_cycles = 0;
+
+static inline void prefetch_fill(int cycles) {
+  // Buffer holds 8 halfwords
+  int cap = 8 * access_cycles[0][1][0x08];
+  prefetch_credit += cycles;
+  if (prefetch_credit > cap) prefetch_credit = cap;
+}
+
+static inline void charge_access(u32 addr, int size) {
+  STATS_INC(bus[addr >> 24][size >> 1]);
+  bool seq = (addr == last_access + size);
+  last_access = addr;
+  int c = access_cycles[size == 4][seq][addr >> 24];
+  bus_cycles += c;
+  // Non-ROM accesses give the prefetcher time; ROM data accesses stop it
+  if ((addr >> 24) - 0x08 < 6) prefetch_credit = 0;
+  else if (prefetch_enabled) prefetch_fill(c);
+}
+
+void memory_update_waitstates(void) {
+  static const u8 sram_n[4] = {4, 3, 2, 8};
+  static const u8 ws_n[4] = {4, 3, 2, 8};
+  static const u8 ws_s[3][2] = {{2, 1}, {4, 1}, {8, 1}};
+  u16 waitcnt = *(u16 *)&io_regs[0x204];
+
+  // Unmapped and on-chip regions: single cycle
+  memset(access_cycles, 1, sizeof(access_cycles));
+  for (int seq = 0; seq < 2; seq++) {
+    // 16-bit buses: EWRAM (2 waitstates), palette, VRAM
+    access_cycles[0][seq][0x02] = 3;
+    access_cycles[1][seq][0x02] = 6;
+    access_cycles[1][seq][0x05] = 2;
+    access_cycles[1][seq][0x06] = 2;
+  }
+
+  // GamePak: WS0 0x08-0x09, WS1 0x0A-0x0B, WS2 0x0C-0x0D. 32-bit accesses
+  // are split into two 16-bit ones, the second one sequential.
+  for (int ws = 0; ws < 3; ws++) {
+    int n = 1 + ws_n[(waitcnt >> (2 + ws * 3)) & 3];
+    int s = 1 + ws_s[ws][(waitcnt >> (4 + ws * 3)) & 1];
+    for (int r = 0x08 + ws * 2; r < 0x0A + ws * 2; r++) {
+      access_cycles[0][0][r] = n;
+      access_cycles[0][1][r] = s;
+      access_cycles[1][0][r] = n + s;
+      access_cycles[1][1][r] = s + s;
     }
-    return 0;
-}
-
-void timer_step(int cycles) {
-    for (int i=0; i<4; i++) {
-        // TMxCNT_H is at offset 0x102 + i*4
-        u16 cnt_h = *(u16 *)&io_regs[0x102 + i*4];
-        
-        bool start = (cnt_h >> 7) & 1;
-        if (!start) continue;
-        
-        // Cascade not implemented yet
-        bool cascade = (cnt_h >> 2) & 1;
-        if (cascade) continue; 
-        
-        int prescaler_setting = cnt_h & 3;
-        int shift = get_prescaler_shift(prescaler_setting);
-        
-        timer_accumulator[i] += cycles;
-        
-        double ticks_needed = (double)(1 << shift);
-        while (timer_accumulator[i] >= ticks_needed) {
-            timer_accumulator[i] -= ticks_needed;
-            timer_counter[i]++;
-            
-            if (timer_counter[i] == 0) { // Overflow
-                timer_counter[i] = timer_reload[i];
-                
-                // IRQ
-                if ((cnt_h >> 6) & 1) {
-                    u16 *if_reg = (u16 *)&io_regs[0x202];
-                    *if_reg |= (1 << (3 + i));
-                }
-                
-                // Audio Channels often use Timer Overflows (DMA Sound)
-                // TODO: Trigger DMA 1/2 sound FIFO if configured?
-            }
-        }
-        
-        // Sync to IO regs for readout
-        *(u16 *)&io_regs[0x100 + i*4] = timer_counter[i];
+  }
+
+  // SRAM: 8-bit bus
+  int sram = 1 + sram_n[waitcnt & 3];
+  for (int w = 0; w < 2; w++) {
+    for (int seq = 0; seq < 2; seq++) {
+      access_cycles[w][seq][0x0E] = sram;
+      access_cycles[w][seq][0x0F] = sram;
     }
+  }
+
+  prefetch_enabled = (waitcnt >> 14) & 1;
+  if (!prefetch_enabled) prefetch_credit = 0;
+}
+
+// Address decoding
+// One entry per 16MB region (addr >> 24) holding the host base, the mirror
+// mask and a fold mask for VRAM's 96KB layout (0x06018000-0x0601FFFF
+// mirrors the 32KB above 0x06010000). Plain memory is served straight from
+// the table; a NULL base falls through to the paths with side effects
+// (BIOS, IO, EEPROM, backup) and finally to open bus.
+typedef struct {
+  u8 *base;
+  u32 mask;
+  u32 fold;
+} Region;
+
+static Region read_map[256];
+static Region write_map[256];
+static Region write8_map[256]; // Video memory byte writes take the slow path
+static u32 open_bus = 0; // Last opcode fetched: what a floating bus reads
+
+static inline u32 region_offset(const Region *r, u32 addr) {
+  u32 off = addr & r->mask;
+  return off & ~((off >> 1) & r->fold);
+}
+
+static void map_region(int index, u8 *base, u32 mask, u32 fold, bool writable) {
+  Region r = {base, mask, fold};
+  read_map[index] = r;
+  if (writable) write_map[index] = r;
+  if (writable && index < 0x05) write8_map[index] = r;
+}
+
+static void memory_map_regions(void) {
+  memset(read_map, 0, sizeof(read_map));
+  memset(write_map, 0, sizeof(write_map));
+  memset(write8_map, 0, sizeof(write8_map));
+  map_region(0x02, wram_on_board, 0x3FFFF, 0, true);
+  map_region(0x03, wram_on_chip, 0x7FFF, 0, true);
+  map_region(0x05, pal_ram, 0x3FF, 0, true);
+  map_region(0x06, vram, 0x1FFFF, 0x8000, true);
+  map_region(0x07, oam, 0x3FF, 0, true);
+  // WS0/WS1/WS2 mirrors. 0x0D stays on the slow path for EEPROM.
+  if (rom_memory) {
+    for (int r = 0x08; r < 0x0D; r++) map_region(r, rom_memory, ROM_MAX - 1, 0, false);
+  }
 }
 
 void memory_init(void) {
@@ -83,15 +153,52 @@ void memory_init(void) {
   memset(wram_on_chip, 0, sizeof(wram_on_chip));
   memset(wram_on_chip, 0, sizeof(wram_on_chip));
   memset(io_regs, 0, sizeof(io_regs));
+  io_init();
+  dma_init();
+  memory_update_waitstates();
+  bus_cycles = 0;
+  last_access = 0xFFFFFFFF;
+  last_fetch = 0xFFFFFFFF;
   // Initialize KEYINPUT to 0x03FF (All Released)
   *(u16 *)&io_regs[0x130] = 0x03FF;
 
   memset(pal_ram, 0, sizeof(pal_ram));
   memset(vram, 0, sizeof(vram));
   memset(oam, 0, sizeof(oam));
+  open_bus = 0;
+  memory_map_regions();
   printf("Memory System Initialized.\n");
 }
 
+// The ROM lives in a buffer covering the whole 32MB GamePak space so WS0-2
+// mirrors are a single mask; reads past the image return the bus pattern
+// (address / 2) the cartridge leaves behind
+static u8 *rom_alloc(u32 size) {
+  if (!rom_buffer) rom_buffer = (u8 *)malloc(ROM_MAX);
+  if (!rom_buffer) return NULL;
+  for (u32 off = size & ~1u; off < ROM_MAX; off += 2) {
+    *(u16 *)&rom_buffer[off] = (u16)(off >> 1);
+  }
+  return rom_buffer;
+}
+
+bool memory_map_rom(const u8 *data, u32 size) {
+  if (!data) {
+    rom_memory = NULL;
+    rom_size = 0;
+    memory_map_regions();
+    return true;
+  }
+  if (size > ROM_MAX) size = ROM_MAX;
+  u8 *buf = rom_alloc(size);
+  if (!buf) return false;
+  memcpy(buf, data, size);
+  rom_memory = buf;
+  rom_size = size;
+  memory_map_regions();
+  return true;
+}
+
 bool memory_load_rom(const char *filename) {
   FILE *f = fopen(filename, "rb");
   if (!f) {
@@ -102,16 +209,22 @@ bool memory_load_rom(const char *filename) {
   fseek(f, 0, SEEK_END);
   long size = ftell(f);
   fseek(f, 0, SEEK_SET);
+  if (size > ROM_MAX) {
+    printf("ROM larger than 32MB, truncating\n");
+    size = ROM_MAX;
+  }
 
-  // Allocazione dinamica (fino a 32MB max per GBA)
-  rom_memory = (u8 *)malloc(size);
-  if (!rom_memory) {
+  u8 *buf = rom_alloc(size);
+  if (!buf) {
     fclose(f);
     return false;
   }
 
-  fread(rom_memory, 1, size, f);
+  fread(buf, 1, size, f);
+  rom_memory = buf;
+  rom_size = size;
   fclose(f);
+  memory_map_regions();
   printf("ROM Loaded: %ld bytes\n", size);
   return true;
 }
@@ -123,205 +236,172 @@ u8 mmu_read8(u32 addr) {
 
 u16 mmu_read16(u32 addr) { return 0; }
 
-u32 bus_read32(u32 addr) {
-  // BIOS
-  if (addr < 0x00004000) {
-    return *(u32 *)&bios[addr];
-  }
-  // EWRAM (0x02000000 - 0x0203FFFF)
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) {
-    return *(u32 *)&wram_on_board[addr - 0x02000000];
-  }
-  // IWRAM (0x03000000 - 0x03007FFF)
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) {
-    return *(u32 *)&wram_on_chip[addr - 0x03000000];
-  }
-  // IO
-  if (addr >= 0x04000000 && addr <= 0x040003FF) {
-    if (addr == 0x04000130) { // KEYINPUT
-      return *(u16 *)&io_regs[0x130];
-    }
-    return *(u32 *)&io_regs[addr - 0x04000000];
-  }
-  // Palette
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-    return *(u32 *)&pal_ram[addr - 0x05000000];
-  }
-  // VRAM (0x06000000 - 0x06017FFF)
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-     return *(u32 *)&vram[addr - 0x06000000];
-  }
-  // ROM
-  if (addr >= 0x08000000 && addr <= 0x09FFFFFF) {
-    if (rom_memory) {
-      u32 offset = addr - 0x08000000;
-      return *(u32 *)&rom_memory[offset];
-    }
-    return 0;
-  }
-  
-  // Backup Memory / Unmapped (SRAM/Flash often here)
-  if (addr >= 0x0E000000) {
-      // Return 0 or FF?
-      return 0xFFFFFFFF; 
-  }
-  
-  return 0; // Open Bus
+// Unmapped reads return the prefetched opcode, replicated on narrow reads
+static u32 slow_read32(u32 addr) {
+  if (addr < 0x00004000) return *(u32 *)&bios[addr & ~3];
+  if ((addr & 0xFFFFFC00) == 0x04000000) return io_read32(addr & 0x3FC);
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) {
+    // 8-bit bus: the byte repeats on every lane
+    return backup_read8(addr) * 0x01010101u;
+  }
+  if (is_eeprom(addr)) return backup_eeprom_read();
+  if ((addr >> 24) == 0x0D && rom_memory) return *(u32 *)&rom_memory[addr & (ROM_MAX - 4)];
+  return open_bus;
+}
+
+static u16 slow_read16(u32 addr) {
+  if (addr < 0x00004000) return *(u16 *)&bios[addr & ~1];
+  if ((addr & 0xFFFFFC00) == 0x04000000) return io_read16(addr & 0x3FE);
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) return backup_read8(addr) * 0x0101;
+  if (is_eeprom(addr)) return backup_eeprom_read();
+  if ((addr >> 24) == 0x0D && rom_memory) return *(u16 *)&rom_memory[addr & (ROM_MAX - 2)];
+  return open_bus >> ((addr & 2) * 8);
+}
+
+static u8 slow_read8(u32 addr) {
+  if (addr < 0x00004000) return bios[addr];
+  if ((addr & 0xFFFFFC00) == 0x04000000) return io_read8(addr & 0x3FF);
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) return backup_read8(addr);
+  if ((addr >> 24) == 0x0D && rom_memory) return rom_memory[addr & (ROM_MAX - 1)];
+  return open_bus >> ((addr & 3) * 8);
 }
 
+static inline u32 read32(u32 addr) {
+  const Region *r = &read_map[addr >> 24];
+  if (r->base) return *(u32 *)&r->base[region_offset(r, addr) & ~3];
+  return slow_read32(addr);
+}
+
+static inline u16 read16(u32 addr) {
+  const Region *r = &read_map[addr >> 24];
+  if (r->base) return *(u16 *)&r->base[region_offset(r, addr) & ~1];
+  return slow_read16(addr);
+}
+
+u32 bus_read32(u32 addr) {
+  charge_access(addr, 4);
+  u32 value = read32(addr);
+  if (trace_enabled) trace_mem(addr, value, 4);
+  return value;
+}
 
 u16 bus_read16(u32 addr) {
-  // BIOS
-  if (addr < 0x00004000) return *(u16 *)&bios[addr];
-  // EWRAM
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) return *(u16 *)&wram_on_board[addr - 0x02000000];
-  // IWRAM
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) return *(u16 *)&wram_on_chip[addr - 0x03000000];
-
-  if (addr >= 0x08000000 && addr <= 0x09FFFFFF) {
-    if (rom_memory) {
-      u32 offset = addr - 0x08000000;
-      return *(u16 *)&rom_memory[offset];
-    }
-    return 0;
-  }
-  if (addr >= 0x04000000 && addr <= 0x040003FF) {
-    if (addr == 0x04000130) { // KEYINPUT
-      u16 val = *(u16 *)&io_regs[0x130];
-      // printf("Reading KEYS. Value: %04X\n", val);
-      return val;
-    }
-    return *(u16 *)&io_regs[addr - 0x04000000];
-  }
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-    return *(u16 *)&pal_ram[addr - 0x05000000];
-  }
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-    return *(u16 *)&vram[addr - 0x06000000];
-  }
-  return 0;
+  charge_access(addr, 2);
+  u16 value = read16(addr);
+  if (trace_enabled) trace_mem(addr, value, 2);
+  return value;
 }
 
-u8 bus_read8(u32 addr) {
-  if (addr < 0x00004000) return bios[addr];
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) return wram_on_board[addr - 0x02000000];
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) return wram_on_chip[addr - 0x03000000];
+// CPU loads with ARMv4T misalignment semantics, computed without branches:
+// LDR rotates the aligned word right by 8 * (addr & 3), LDRH rotates the
+// aligned halfword by 8 on odd addresses and LDRSH of an odd address
+// sign-extends the high byte
+u32 bus_load32(u32 addr) {
+  u32 val = bus_read32(addr);
+  u32 rot = (addr & 3) * 8;
+  return (val >> rot) | (val << ((32 - rot) & 31));
+}
 
-  if (addr >= 0x08000000 && addr <= 0x09FFFFFF) {
-    if (rom_memory) {
-      return rom_memory[addr - 0x08000000];
-    }
-  }
-  if (addr >= 0x04000000 && addr <= 0x040003FF) {
-    return io_regs[addr - 0x04000000];
-  }
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-    return pal_ram[addr - 0x05000000];
-  }
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-    return vram[addr - 0x06000000];
-  }
-  return 0;
+u32 bus_load16(u32 addr) {
+  u32 val = bus_read16(addr);
+  u32 rot = (addr & 1) * 8;
+  return (val >> rot) | (val << ((32 - rot) & 31));
+}
+
+u32 bus_load16s(u32 addr) {
+  u32 val = bus_read16(addr);
+  return (u32)((s32)(val << 16) >> (16 + (addr & 1) * 8));
+}
+
+u8 bus_read8(u32 addr) {
+  charge_access(addr, 1);
+  const Region *r = &read_map[addr >> 24];
+  u8 value = r->base ? r->base[region_offset(r, addr)] : slow_read8(addr);
+  if (trace_enabled) trace_mem(addr, value, 1);
+  return value;
 }
 
+// Bus Write Functions
+// Writes to BIOS, ROM and unmapped space are dropped
 void bus_write32(u32 addr, u32 value) {
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) {
-    *(u32 *)&wram_on_board[addr - 0x02000000] = value;
+  charge_access(addr, 4);
+  if (trace_enabled) trace_mem(addr, value, 4 | TRACE_MEM_WRITE);
+  const Region *r = &write_map[addr >> 24];
+  if (r->base) {
+    *(u32 *)&r->base[region_offset(r, addr) & ~3] = value;
     return;
   }
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) {
-    *(u32 *)&wram_on_chip[addr - 0x03000000] = value;
+  if ((addr & 0xFFFFFC00) == 0x04000000) {
+    io_write32(addr & 0x3FC, value);
     return;
   }
-  if (addr == 0x03001BCC) {
-      printf("[MemTrace] Write32 to VBlank Vector 1BCC: %08X\n", value);
-  }
-  // Also Trace 1BC0 base
-  if (addr >= 0x03001BC0 && addr <= 0x03001BD0) {
-      // printf("[MemTrace] Write32 to Vector Area %08X: %08X\n", addr, value);
-  }
-  if (addr >= 0x04000000 && addr <= 0x040003FF) {
-      // Debug IO Writes: Log EVERYTHING in 04xxxxxx range for now
-      printf("[IO] Write32: [%08X] = %08X\n", addr, value);
-      *(u32 *)&io_regs[addr - 0x04000000] = value;
-      
-      // Check for DMA Control Write (32-bit)
-      // DMAxCNT is at Offset B8, C4, D0, DC.
-      // Top 16 bits are Control.
-      u32 offset = addr - 0x04000000;
-      if (offset == 0xB8) check_dma(0, value >> 16);
-      else if (offset == 0xC4) check_dma(1, value >> 16);
-      else if (offset == 0xD0) check_dma(2, value >> 16);
-      else if (offset == 0xDC) check_dma(3, value >> 16);
-      
-      return;
-  }
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-      *(u32 *)&pal_ram[addr - 0x05000000] = value;
-      return;
-  }
-  
-  if (addr == 0x04000000) {
-      printf("[IO] Write32 DISPCNT = %04X\n", value);
-  }
-  
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-      *(u32 *)&vram[addr - 0x06000000] = value;
-      return;
+  // Backup: only one byte reaches the 8-bit bus
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) {
+    backup_write8(addr, value >> ((addr & 3) * 8));
+    return;
   }
-  // printf("[BUS] Write32: [%08X] = %08X\n", addr, value);
+  if (is_eeprom(addr)) backup_eeprom_write(value);
+}
+
+// Video memory sits on a 16-bit bus: a byte store to palette or BG VRAM
+// writes the byte to both halves of the halfword, while OBJ VRAM and OAM
+// ignore byte stores entirely
+static void video_write8(u32 addr, u8 value) {
+  const Region *r = &write_map[addr >> 24];
+  u32 off = region_offset(r, addr) & ~1;
+  if ((addr >> 24) == 0x06) {
+    u32 obj_base = (io_regs[0] & 7) >= 3 ? 0x14000 : 0x10000;
+    if (off >= obj_base) return;
+  }
+  *(u16 *)&r->base[off] = value * 0x0101;
 }
 
-// Bus Write Functions
 void bus_write8(u32 addr, u8 value) {
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) {
-    wram_on_board[addr - 0x02000000] = value;
+  charge_access(addr, 1);
+  if (trace_enabled) trace_mem(addr, value, 1 | TRACE_MEM_WRITE);
+  const Region *r = &write8_map[addr >> 24];
+  if (r->base) {
+    r->base[region_offset(r, addr)] = value;
     return;
   }
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) {
-    wram_on_chip[addr - 0x03000000] = value;
+  if ((addr & 0xFFFFFC00) == 0x04000000) {
+    io_write8(addr & 0x3FF, value);
     return;
   }
-   if (addr >= 0x04000000 && addr <= 0x040003FF) {
-    io_regs[addr - 0x04000000] = value;
-    return;
-  }
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-    pal_ram[addr - 0x05000000] = value;
-    return;
-  }
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-    vram[addr - 0x06000000] = value;
+  if ((addr >> 24) == 0x05 || (addr >> 24) == 0x06) {
+    video_write8(addr, value);
     return;
   }
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) backup_write8(addr, value);
 }
 
 void bus_write16(u32 addr, u16 value) {
-  if (addr >= 0x02000000 && addr <= 0x0203FFFF) {
-      *(u16 *)&wram_on_board[addr - 0x02000000] = value;
-      return;
-  }
-  if (addr >= 0x03000000 && addr <= 0x03007FFF) {
-      *(u16 *)&wram_on_chip[addr - 0x03000000] = value;
-      return;
-  }
-  if (addr >= 0x04000000 && addr <= 0x040003FF) {
-      *(u16 *)&io_regs[addr - 0x04000000] = value;
-      return;
+  charge_access(addr, 2);
+  if (trace_enabled) trace_mem(addr, value, 2 | TRACE_MEM_WRITE);
+  const Region *r = &write_map[addr >> 24];
+  if (r->base) {
+    *(u16 *)&r->base[region_offset(r, addr) & ~1] = value;
+    return;
   }
-  if (addr >= 0x05000000 && addr <= 0x050003FF) {
-      *(u16 *)&pal_ram[addr - 0x05000000] = value;
-      return;
+  if ((addr & 0xFFFFFC00) == 0x04000000) {
+    io_write16(addr & 0x3FE, value);
+    return;
   }
-  if (addr >= 0x06000000 && addr <= 0x06017FFF) {
-    u32 offset = addr - 0x06000000;
-    *(u16 *)&vram[offset] = value;
+  if (addr >= 0x0E000000 && addr <= 0x0FFFFFFF) {
+    backup_write8(addr, value >> ((addr & 1) * 8));
     return;
   }
+  if (is_eeprom(addr)) backup_eeprom_write(value);
 }
 
 
+void memory_load_bios(const u8 *data, u32 size) {
+  if (size > sizeof(bios)) size = sizeof(bios);
+  memcpy(bios, data, size);
+}
+
 // Helpers
+u32 memory_rom_size(void) { return rom_size; }
 u8 *memory_get_vram(void) { return vram; }
 u8 *memory_get_io(void) { return io_regs; }
 u8 *memory_get_pal(void) { return pal_ram; }
@@ -342,112 +422,98 @@ void mmu_write16(u32 addr, u16 value) {
 }
 u8 *memory_get_oam() { return oam; }
 
-// DMA Helper (Forward declaration or impl)
-static void perform_dma(int channel) {
-    // u32 base = 0x040000B0 + (channel * 12); // Unused
-    // Determine IO offset correctly
-    // Global io_regs are at base 0 from pointer view?
-    // memory_get_io() returns pointer to 0x04000000 base.
-    // io_regs used in perform_dma assumes io_regs is a global array? 
-    // Wait, perform_dma in my previous paste used `io_regs` which is defined as `static u8 io_regs[0x400]` in memory.c?
-    // Let's check definition of io_regs. usually it's `io_regs` or `io`.
-    // In check_dma (line 283) it gets `u8 *io = memory_get_io();`
-    // My perform_dma code used `io_regs` which might be invalid if not in scope or named differently.
-    // Let's use memory_get_io().
-    
-    u8 *io = memory_get_io();
-    u32 offset = 0xB0 + (channel * 12);
-    
-    u32 sad = *(u32 *)&io[offset];
-    u32 dad = *(u32 *)&io[offset + 4];
-    u16 cnt_l = *(u16 *)&io[offset + 8];
-    u16 control_val = *(u16 *)&io[offset + 10];
-
-    bool is_32 = (control_val >> 10) & 1;
-    int count = cnt_l;
-    if (count == 0) count = (channel == 3) ? 0x10000 : 0x4000;
-    
-    int dest_adj = (control_val >> 5) & 3; 
-    int src_adj = (control_val >> 7) & 3;
-    
-    u32 src = sad;
-    u32 dst = dad;
-    int step = is_32 ? 4 : 2;
-    
-    for (int i=0; i<count; i++) {
-        if (is_32) {
-            u32 val = bus_read32(src);
-            bus_write32(dst, val);
-        } else {
-            u16 val = bus_read16(src);
-            bus_write16(dst, val);
-        }
-        
-        if (src_adj == 0) src += step;
-        else if (src_adj == 1) src -= step;
-        
-        if (dest_adj == 0) dst += step;
-        else if (dest_adj == 1) dst -= step;
-    }
-    
-    if (!((control_val >> 9) & 1)) { // Repeat Bit 9
-        u16 new_ctrl = control_val & ~(1 << 15);
-        *(u16 *)&io[offset + 10] = new_ctrl;
-    } else {
-        *(u32 *)&io[offset] = src;
-        // DAD reload logic depends on control bits (bits 5-6)
-        // Fixed (2) = DAD stays same. Reload (3) = DAD reloaded.
-        // If Repeat on, we should handle DAD/SAD writeback specifically.
-        // For Audio (Fixed Dest), DAD doesn't change implicitly in loop, but here we just restore?
-        // Let's assume standard behavior for now.
-    }
-    
-    // Trigger DMA IRQ if enabled (Bit 14)
-    if ((control_val >> 14) & 1) {
-        u16 *if_reg = (u16 *)&io[0x202];
-        *if_reg |= (1 << (8 + channel)); // DMA0=8, DMA1=9, DMA2=10, DMA3=11
-    }
+// Host pointer to addr inside one plain memory region and the bytes left
+// before the region ends, for bulk transfers that need no per-access side
+// effects. GamePak ROM is visible through all three wait-state mirrors.
+u8 *memory_region_span(u32 addr, bool write, u32 *avail) {
+  u8 *base = NULL;
+  u32 size = 0;
+  u32 offset = addr & 0xFFFFFF;
+  switch (addr >> 24) {
+  case 0x00:
+    if (!write) base = bios, size = sizeof(bios);
+    break;
+  case 0x02:
+    base = wram_on_board, size = sizeof(wram_on_board);
+    break;
+  case 0x03:
+    base = wram_on_chip, size = sizeof(wram_on_chip);
+    break;
+  case 0x05:
+    base = pal_ram, size = sizeof(pal_ram);
+    break;
+  case 0x06:
+    base = vram, size = sizeof(vram);
+    break;
+  case 0x07:
+    base = oam, size = sizeof(oam);
+    break;
+  case 0x08: case 0x09: case 0x0A: case 0x0B: case 0x0C: case 0x0D:
+    if (!write && rom_memory) base = rom_memory, size = rom_size;
+    offset = addr & (ROM_MAX - 1);
+    break;
+  }
+  if (!base || offset >= size) return NULL;
+  *avail = size - offset;
+  return base + offset;
 }
 
-void check_dma(int channel, u16 control_val) {
-    bool enable = (control_val >> 15) & 1;
-    int timing = (control_val >> 12) & 3; 
-    
-    // printf("[DMA] Check Ch%d Cnt=%04X En=%d Time=%d\n", channel, control_val, enable, timing);
-    
-    if (enable) {
-        if (timing == 0) {
-            printf("[DMA] Immediate Trigger Ch%d\n", channel);
-            perform_dma(channel);
-        } else if (timing == 3) {
-            // Audio Logic...
-             u8 *io = memory_get_io();
-             u32 offset = 0xB0 + (channel * 12);
-             u32 dad = *(u32 *)&io[offset + 4];
-             if (dad == 0x040000A0 || dad == 0x040000A4) {
-                  perform_dma(channel);
-             }
-        }
-    }
+u8 *memory_region_ptr(u32 addr, u32 len, bool write) {
+  u32 avail;
+  u8 *host = memory_region_span(addr, write, &avail);
+  return (host && len <= avail) ? host : NULL;
 }
-// Note: perform_dma logging:
-// static void perform_dma... (Need to modify earlier function)
-
-void memory_check_dma_vblank(void) {
-    for (int i=0; i<4; i++) {
-        u32 base = 0x040000B0 + (i * 12);
-        int io_offset = base - 0x04000000;
-        u16 control_val = *(u16 *)&io_regs[io_offset + 10];
-        
-        bool enable = (control_val >> 15) & 1;
-        int timing = (control_val >> 12) & 3;
-        
-        // Timing 1 = VBlank
-        if (enable && timing == 1) {
-            // printf("[DMA] VBlank Trigger Channel %d\n", i);
-            perform_dma(i);
-        }
-    }
+
+// Charge `words` consecutive word accesses starting at addr (N then S...)
+void memory_charge_block(u32 addr, int words) {
+  for (int i = 0; i < words; i++) charge_access(addr + i * 4, 4);
+}
+
+int memory_access_cycles(u32 addr, bool is_32, bool sequential) {
+  return access_cycles[is_32][sequential][addr >> 24];
+}
+
+// Opcode fetches: sequential GamePak fetches already in the prefetch
+// buffer complete in a single cycle
+static inline void charge_fetch(u32 addr, int size) {
+  bool seq = (addr == last_fetch + size);
+  last_fetch = addr;
+  if ((addr >> 24) - 0x08 >= 6) {
+    charge_access(addr, size);
+    return;
+  }
+  STATS_INC(bus[addr >> 24][size >> 1]);
+  int need = access_cycles[size == 4][seq][addr >> 24];
+  last_access = addr;
+  if (!seq || !prefetch_enabled) {
+    // Non-sequential GamePak fetch restarts the prefetcher
+    bus_cycles += need;
+    prefetch_credit = 0;
+  } else if (prefetch_credit >= need) {
+    prefetch_credit -= need;
+    bus_cycles += 1;
+  } else {
+    bus_cycles += need - prefetch_credit;
+    prefetch_credit = 0;
+  }
+}
+
+u32 bus_fetch32(u32 addr) {
+  charge_fetch(addr, 4);
+  open_bus = read32(addr);
+  return open_bus;
+}
+
+u16 bus_fetch16(u32 addr) {
+  charge_fetch(addr, 2);
+  u16 op = read16(addr);
+  open_bus = op * 0x00010001u;
+  return op;
+}
+
+// Internal CPU cycles: the prefetcher keeps filling while the bus is idle
+void memory_idle(int cycles) {
+  if (prefetch_enabled) prefetch_fill(cycles);
 }
 
 void mmu_write32(u32 addr, u32 value) {
@@ -0,0 +1,558 @@
+#include "../include/png.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checksums
+
+static u32 crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+  for (u32 n = 0; n < 256; n++) {
+    u32 c = n;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    crc_table[n] = c;
+  }
+}
+
+u32 png_crc32(u32 crc, const u8 *data, size_t len) {
+  pthread_once(&crc_once, crc_init);
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+u32 png_adler32(u32 adler, const u8 *data, size_t len) {
+  u32 a = adler & 0xFFFF, b = adler >> 16;
+  while (len > 0) {
+    // 5552 is the largest block that cannot overflow b before the modulo
+    size_t n = len < 5552 ? len : 5552;
+    len -= n;
+    while (n--) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+// Bit Writer (deflate packs bits LSB first)
+
+typedef struct {
+  u8 *out;
+  size_t pos;
+  u64 bits;
+  int count;
+} BitWriter;
+
+static inline void bits_put(BitWriter *bw, u32 value, int n) {
+  bw->bits |= (u64)value << bw->count;
+  bw->count += n;
+  while (bw->count >= 8) {
+    bw->out[bw->pos++] = (u8)bw->bits;
+    bw->bits >>= 8;
+    bw->count -= 8;
+  }
+}
+
+static void bits_flush(BitWriter *bw) {
+  if (bw->count > 0) bw->out[bw->pos++] = (u8)bw->bits;
+  bw->bits = 0;
+  bw->count = 0;
+}
+
+// Fixed Huffman Tables (RFC 1951 3.2.6)
+
+static const u16 len_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const u8 len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const u16 dist_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                  33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const u8 dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Bit-reversed fixed codes, ready for an LSB-first writer
+static u16 lit_code[288];
+static u8 lit_bits[288];
+static u16 dist_code[30];
+static u8 len_symbol[259]; // Match length -> index into len_base
+static u8 dist_symbol_lo[257]; // Distance 1..256 -> code
+static u8 dist_symbol_hi[256]; // (Distance - 1) >> 7 for distances > 256
+static pthread_once_t huff_once = PTHREAD_ONCE_INIT;
+
+static u16 reverse_bits(u16 code, int n) {
+  u16 r = 0;
+  for (int i = 0; i < n; i++) {
+    r = (r << 1) | (code & 1);
+    code >>= 1;
+  }
+  return r;
+}
+
+static void huff_init(void) {
+  for (int sym = 0; sym < 288; sym++) {
+    u16 code;
+    int n;
+    if (sym < 144) { code = 0x30 + sym; n = 8; }
+    else if (sym < 256) { code = 0x190 + (sym - 144); n = 9; }
+    else if (sym < 280) { code = sym - 256; n = 7; }
+    else { code = 0xC0 + (sym - 280); n = 8; }
+    lit_code[sym] = reverse_bits(code, n);
+    lit_bits[sym] = (u8)n;
+  }
+  for (int d = 0; d < 30; d++) dist_code[d] = reverse_bits(d, 5);
+
+  for (int i = 0; i < 29; i++) {
+    int end = (i == 28) ? 259 : len_base[i + 1];
+    for (int l = len_base[i]; l < end; l++) len_symbol[l] = (u8)i;
+  }
+  len_symbol[258] = 28;
+
+  for (int i = 0; i < 30; i++) {
+    int end = (i == 29) ? 32769 : dist_base[i + 1];
+    for (int d = dist_base[i]; d < end; d++) {
+      if (d <= 256) dist_symbol_lo[d] = (u8)i;
+      else dist_symbol_hi[(d - 1) >> 7] = (u8)i;
+    }
+  }
+}
+
+static inline void put_literal(BitWriter *bw, u8 lit) {
+  bits_put(bw, lit_code[lit], lit_bits[lit]);
+}
+
+static inline void put_match(BitWriter *bw, int length, int distance) {
+  int li = len_symbol[length];
+  bits_put(bw, lit_code[257 + li], lit_bits[257 + li]);
+  if (len_extra[li]) bits_put(bw, length - len_base[li], len_extra[li]);
+
+  int di = (distance <= 256) ? dist_symbol_lo[distance] : dist_symbol_hi[(distance - 1) >> 7];
+  bits_put(bw, dist_code[di], 5);
+  if (dist_extra[di]) bits_put(bw, distance - dist_base[di], dist_extra[di]);
+}
+
+// Deflate
+
+#define WINDOW_SIZE 32768
+#define HASH_BITS 15
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+static inline u32 hash3(const u8 *p) {
+  u32 v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void deflate_stored(BitWriter *bw, const u8 *data, size_t len) {
+  size_t pos = 0;
+  do {
+    size_t n = len - pos;
+    if (n > 65535) n = 65535;
+    bool final = (pos + n == len);
+    bits_put(bw, final ? 1 : 0, 3); // BFINAL, BTYPE=00
+    bits_flush(bw);
+    bw->out[bw->pos++] = n & 0xFF;
+    bw->out[bw->pos++] = (n >> 8) & 0xFF;
+    bw->out[bw->pos++] = ~n & 0xFF;
+    bw->out[bw->pos++] = (~n >> 8) & 0xFF;
+    memcpy(&bw->out[bw->pos], &data[pos], n);
+    bw->pos += n;
+    pos += n;
+  } while (pos < len);
+}
+
+// Single greedy pass: one hash probe per position, one fixed-Huffman block
+static void deflate_fast(BitWriter *bw, const u8 *data, size_t len) {
+  s32 *head = (s32 *)malloc(sizeof(s32) << HASH_BITS);
+  if (!head) {
+    deflate_stored(bw, data, len);
+    return;
+  }
+  for (int i = 0; i < (1 << HASH_BITS); i++) head[i] = -1;
+
+  bits_put(bw, 1 | (1 << 1), 3); // BFINAL=1, BTYPE=01 (fixed)
+
+  size_t pos = 0;
+  while (pos < len) {
+    int best_len = 0;
+    size_t best_dist = 0;
+    if (pos + MIN_MATCH <= len) {
+      u32 h = hash3(&data[pos]);
+      s32 cand = head[h];
+      head[h] = (s32)pos;
+      if (cand >= 0 && pos - cand <= WINDOW_SIZE) {
+        size_t max = len - pos;
+        if (max > MAX_MATCH) max = MAX_MATCH;
+        const u8 *a = &data[pos];
+        const u8 *b = &data[cand];
+        size_t l = 0;
+        while (l < max && a[l] == b[l]) l++;
+        if (l >= MIN_MATCH) {
+          best_len = (int)l;
+          best_dist = pos - cand;
+        }
+      }
+    }
+
+    if (best_len) {
+      put_match(bw, best_len, (int)best_dist);
+      // Index the skipped positions so later matches can find them
+      size_t end = pos + best_len;
+      for (size_t p = pos + 1; p < end && p + MIN_MATCH <= len; p++) {
+        head[hash3(&data[p])] = (s32)p;
+      }
+      pos = end;
+    } else {
+      put_literal(bw, data[pos]);
+      pos++;
+    }
+  }
+  bits_put(bw, lit_code[256], lit_bits[256]); // End of block
+  bits_flush(bw);
+  free(head);
+}
+
+// Raw deflate streams (no zlib wrapper), shared with the trace writer
+
+size_t png_deflate(const u8 *data, size_t len, u8 **out) {
+  pthread_once(&huff_once, huff_init);
+  size_t bound = len + len / 8 + (len / 65535 + 1) * 5 + 16;
+  BitWriter bw = {(u8 *)malloc(bound), 0, 0, 0};
+  if (!bw.out) {
+    *out = NULL;
+    return 0;
+  }
+  deflate_fast(&bw, data, len);
+  *out = bw.out;
+  return bw.pos;
+}
+
+// Bit Reader (mirror of the writer)
+
+typedef struct {
+  const u8 *in;
+  size_t len;
+  size_t pos;
+  u32 bits;
+  int count;
+  bool overrun;
+} BitReader;
+
+static u32 bits_get(BitReader *br, int n) {
+  while (br->count < n) {
+    if (br->pos < br->len) br->bits |= (u32)br->in[br->pos++] << br->count;
+    else br->overrun = true;
+    br->count += 8;
+  }
+  u32 v = br->bits & ((1u << n) - 1);
+  br->bits >>= n;
+  br->count -= n;
+  return v;
+}
+
+// Huffman codes are packed starting from their most significant bit
+static u32 huff_get(BitReader *br, u32 code, int from, int to) {
+  for (int i = from; i < to; i++) code = (code << 1) | bits_get(br, 1);
+  return code;
+}
+
+static int fixed_literal(BitReader *br) {
+  u32 code = huff_get(br, 0, 0, 7);
+  if (code < 0x18) return 256 + code;
+  code = huff_get(br, code, 7, 8);
+  if (code >= 0x30 && code < 0xC0) return code - 0x30;
+  if (code >= 0xC0 && code < 0xC8) return 280 + (code - 0xC0);
+  code = huff_get(br, code, 8, 9);
+  return 144 + (code - 0x190);
+}
+
+size_t png_inflate(const u8 *data, size_t len, u8 *out, size_t out_len) {
+  BitReader br = {data, len, 0, 0, 0, false};
+  size_t pos = 0;
+  bool final;
+  do {
+    final = bits_get(&br, 1);
+    u32 type = bits_get(&br, 2);
+    if (type == 0) {
+      bits_get(&br, br.count & 7); // Byte-align
+      u32 n = bits_get(&br, 16);
+      if ((bits_get(&br, 16) ^ n) != 0xFFFF) return (size_t)-1;
+      // Whole bytes still buffered in the accumulator come first
+      while (n && br.count) {
+        if (pos == out_len) return (size_t)-1;
+        out[pos++] = (u8)bits_get(&br, 8);
+        n--;
+      }
+      if (br.pos + n > br.len || pos + n > out_len) return (size_t)-1;
+      memcpy(&out[pos], &br.in[br.pos], n);
+      br.pos += n;
+      pos += n;
+    } else if (type == 1) {
+      for (;;) {
+        int sym = fixed_literal(&br);
+        if (br.overrun) return (size_t)-1;
+        if (sym < 256) {
+          if (pos == out_len) return (size_t)-1;
+          out[pos++] = (u8)sym;
+          continue;
+        }
+        if (sym == 256) break;
+        if (sym > 285) return (size_t)-1;
+        int li = sym - 257;
+        size_t length = len_base[li] + bits_get(&br, len_extra[li]);
+        u32 di = huff_get(&br, 0, 0, 5);
+        if (di >= 30) return (size_t)-1;
+        size_t distance = dist_base[di] + bits_get(&br, dist_extra[di]);
+        if (distance > pos || pos + length > out_len) return (size_t)-1;
+        // Byte by byte: overlapping matches repeat the run
+        for (size_t i = 0; i < length; i++, pos++) out[pos] = out[pos - distance];
+      }
+    } else {
+      return (size_t)-1; // Dynamic Huffman: never produced by png_deflate
+    }
+    if (br.overrun) return (size_t)-1;
+  } while (!final);
+  return pos;
+}
+
+// PNG Encoding
+
+static inline int paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  if (pb <= pc) return b;
+  return c;
+}
+
+// Filter every scanline, picking the filter with the smallest sum of
+// absolute signed residuals (the heuristic libpng uses). False when the
+// scanline buffers cannot be allocated.
+static bool filter_image(const u32 *argb, int width, int height, u8 *raw) {
+  const int bpp = 3;
+  const int stride = width * bpp;
+  u8 *cur = (u8 *)malloc(stride * 2);
+  u8 *trial = (u8 *)malloc(stride);
+  if (!cur || !trial) {
+    free(cur);
+    free(trial);
+    return false;
+  }
+  u8 *prev = cur + stride;
+  memset(prev, 0, stride);
+
+  for (int y = 0; y < height; y++) {
+    const u32 *src = &argb[y * width];
+    for (int x = 0; x < width; x++) {
+      cur[x * 3 + 0] = (src[x] >> 16) & 0xFF;
+      cur[x * 3 + 1] = (src[x] >> 8) & 0xFF;
+      cur[x * 3 + 2] = src[x] & 0xFF;
+    }
+
+    u8 *dst = &raw[y * (stride + 1)];
+    u32 best_score = 0xFFFFFFFF;
+    for (int f = 0; f < 5; f++) {
+      u32 score = 0;
+      for (int i = 0; i < stride; i++) {
+        int a = (i >= bpp) ? cur[i - bpp] : 0;
+        int b = prev[i];
+        int c = (i >= bpp) ? prev[i - bpp] : 0;
+        int pred = 0;
+        switch (f) {
+        case 1: pred = a; break;
+        case 2: pred = b; break;
+        case 3: pred = (a + b) >> 1; break;
+        case 4: pred = paeth(a, b, c); break;
+        }
+        u8 r = (u8)(cur[i] - pred);
+        trial[i] = r;
+        score += (r < 128) ? r : 256 - r;
+      }
+      if (score < best_score) {
+        best_score = score;
+        dst[0] = (u8)f;
+        memcpy(dst + 1, trial, stride);
+      }
+    }
+    memcpy(prev, cur, stride);
+  }
+  free(cur);
+  free(trial);
+  return true;
+}
+
+static void put_be32(u8 *p, u32 v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// Writes length + type, returns pointer to chunk data
+static u8 *chunk_begin(u8 *p, const char *type, u32 length) {
+  put_be32(p, length);
+  memcpy(p + 4, type, 4);
+  return p + 8;
+}
+
+// Appends the CRC over type + data, returns the end of the chunk
+static u8 *chunk_end(u8 *data, u32 length) {
+  put_be32(data + length, png_crc32(0, data - 4, length + 4));
+  return data + length + 4;
+}
+
+size_t png_encode(const u32 *argb, int width, int height, int level, u8 **out) {
+  pthread_once(&huff_once, huff_init);
+
+  size_t raw_len = (size_t)height * (width * 3 + 1);
+  // Fixed Huffman expands a literal to at most 9 bits; stored adds 5 bytes
+  // per 64KB block. Headers and chunks fit in the extra 256.
+  size_t bound = raw_len + raw_len / 8 + (raw_len / 65535 + 1) * 5 + 256;
+  u8 *raw = (u8 *)malloc(raw_len);
+  u8 *buf = (u8 *)malloc(bound);
+  if (!raw || !buf || !filter_image(argb, width, height, raw)) {
+    free(raw);
+    free(buf);
+    *out = NULL;
+    return 0;
+  }
+
+  u8 *p = buf;
+  static const u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  memcpy(p, signature, 8);
+  p += 8;
+
+  u8 *ihdr = chunk_begin(p, "IHDR", 13);
+  put_be32(ihdr, width);
+  put_be32(ihdr + 4, height);
+  ihdr[8] = 8;  // Bit depth
+  ihdr[9] = 2;  // Color type: RGB
+  ihdr[10] = 0; // Deflate
+  ihdr[11] = 0; // Adaptive filtering
+  ihdr[12] = 0; // No interlace
+  p = chunk_end(ihdr, 13);
+
+  // IDAT length is patched once the stream size is known
+  u8 *idat_start = p;
+  u8 *idat = chunk_begin(p, "IDAT", 0);
+  BitWriter bw = {idat, 0, 0, 0};
+  bw.out[bw.pos++] = 0x78; // CMF: deflate, 32KB window
+  bw.out[bw.pos++] = 0x01; // FLG: fastest, check bits
+  if (level == PNG_LEVEL_STORED) deflate_stored(&bw, raw, raw_len);
+  else deflate_fast(&bw, raw, raw_len);
+  put_be32(&bw.out[bw.pos], png_adler32(1, raw, raw_len));
+  bw.pos += 4;
+  put_be32(idat_start, (u32)bw.pos);
+  p = chunk_end(idat, (u32)bw.pos);
+
+  u8 *iend = chunk_begin(p, "IEND", 0);
+  p = chunk_end(iend, 0);
+
+  free(raw);
+  *out = buf;
+  return (size_t)(p - buf);
+}
+
+bool png_write(const char *filename, const u32 *argb, int width, int height) {
+  u8 *data = NULL;
+  size_t len = png_encode(argb, width, height, PNG_LEVEL_FAST, &data);
+  if (!len) {
+    printf("Failed to encode PNG: %s\n", filename);
+    return false;
+  }
+
+  FILE *f = fopen(filename, "wb");
+  if (!f) {
+    printf("Failed to create PNG: %s\n", filename);
+    free(data);
+    return false;
+  }
+  bool ok = fwrite(data, 1, len, f) == len;
+  fclose(f);
+  free(data);
+  return ok;
+}
+
+// Asynchronous Writer
+// A single worker thread drains a small FIFO of pixel snapshots.
+
+#define PNG_QUEUE_SIZE 4
+
+typedef struct {
+  char filename[256];
+  u32 *pixels;
+  int width, height;
+} PngJob;
+
+static PngJob queue[PNG_QUEUE_SIZE];
+static int queue_head = 0, queue_count = 0;
+static bool worker_started = false;
+static bool worker_busy = false;
+static pthread_t worker_thread;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_space = PTHREAD_COND_INITIALIZER;
+
+static void *png_worker(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&queue_lock);
+  for (;;) {
+    while (queue_count == 0) pthread_cond_wait(&queue_ready, &queue_lock);
+    PngJob job = queue[queue_head];
+    queue_head = (queue_head + 1) % PNG_QUEUE_SIZE;
+    queue_count--;
+    worker_busy = true;
+    pthread_mutex_unlock(&queue_lock);
+
+    if (png_write(job.filename, job.pixels, job.width, job.height)) {
+      printf("Screenshot saved to %s\n", job.filename);
+    }
+    free(job.pixels);
+
+    pthread_mutex_lock(&queue_lock);
+    worker_busy = false;
+    pthread_cond_broadcast(&queue_space);
+  }
+  return NULL;
+}
+
+bool png_write_async(const char *filename, const u32 *argb, int width, int height) {
+  size_t size = (size_t)width * height * sizeof(u32);
+  u32 *copy = (u32 *)malloc(size);
+  if (!copy) return png_write(filename, argb, width, height);
+  memcpy(copy, argb, size);
+
+  pthread_mutex_lock(&queue_lock);
+  if (!worker_started) {
+    if (pthread_create(&worker_thread, NULL, png_worker, NULL) != 0) {
+      pthread_mutex_unlock(&queue_lock);
+      free(copy);
+      return png_write(filename, argb, width, height);
+    }
+    pthread_detach(worker_thread);
+    worker_started = true;
+  }
+  while (queue_count == PNG_QUEUE_SIZE) pthread_cond_wait(&queue_space, &queue_lock);
+
+  PngJob *job = &queue[(queue_head + queue_count) % PNG_QUEUE_SIZE];
+  snprintf(job->filename, sizeof(job->filename), "%s", filename);
+  job->pixels = copy;
+  job->width = width;
+  job->height = height;
+  queue_count++;
+  pthread_cond_signal(&queue_ready);
+  pthread_mutex_unlock(&queue_lock);
+  return true;
+}
+
+void png_async_flush(void) {
+  pthread_mutex_lock(&queue_lock);
+  while (queue_count > 0 || worker_busy) pthread_cond_wait(&queue_space, &queue_lock);
+  pthread_mutex_unlock(&queue_lock);
+}
@@ -1,5 +1,10 @@
 #include "../include/ppu.h"
+#include "../include/io.h"
 #include "../include/memory.h"
+#include "../include/dma.h"
+#include "../include/frame_hash.h"
+#include "../include/png.h"
+#include "../include/stats.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -35,7 +40,9 @@ void ppu_update(int cycles) {
     if (cycle_bucket >= CYCLES_HDRAW) {
         if (!(old_stat & 2)) { // Rising Edge HBlank
            new_stat |= 2;
-           if (new_stat & 0x10) *(u16 *)&io[0x202] |= 2; // IRQ
+           if (new_stat & 0x10) io_request_irq(2); // IRQ
+           if (vcount < 160) dma_on_hblank();
+           dma_on_video_capture(vcount);
         }
     } else {
         new_stat &= ~2; // Clear HBlank
@@ -52,10 +59,10 @@ void ppu_update(int cycles) {
         if (vcount == 160) {
             new_stat |= 1; // Set VBlank
             if (new_stat & 0x08) {
-                 *(u16 *)&io[0x202] |= 1; // IRQ
+                 io_request_irq(1); // IRQ
                  // printf("[PPU] VBlank IRQ Request\n");
             }
-            memory_check_dma_vblank();
+            dma_on_vblank();
         } 
         else if (vcount == 0) { // End of VBlank
              new_stat &= ~1; // Clear VBlank
@@ -65,7 +72,7 @@ void ppu_update(int cycles) {
         u8 vcount_setting = (new_stat >> 8) & 0xFF;
         if (vcount == vcount_setting) {
              new_stat |= 4; // Set Match
-             if (new_stat & 0x20) *(u16 *)&io[0x202] |= 4; // IRQ
+             if (new_stat & 0x20) io_request_irq(4); // IRQ
         } else {
              new_stat &= ~4;
         }
@@ -74,6 +81,11 @@ void ppu_update(int cycles) {
     *(u16 *)&io[4] = new_stat;
 }
 
+int ppu_cycles_until_event(void) {
+    // HBlank starts at 960, the line ends at 1232 (see ppu_update)
+    return (cycle_bucket < 960) ? 960 - cycle_bucket : 1232 - cycle_bucket;
+}
+
 // Helper: Read palette color
 u16 ppu_read_palette(int index) {
     u8 *pal = memory_get_pal();
@@ -325,30 +337,58 @@ void ppu_render_oam(u32 *scanline_buffer, int line) {
 // Internal Framebuffer for Headless/Screenshot
 static u32 internal_framebuffer[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT];
 
-void ppu_save_screenshot(const char *filename) {
+static bool has_png_extension(const char *filename) {
+    size_t len = strlen(filename);
+    return len >= 4 && strcmp(filename + len - 4, ".png") == 0;
+}
+
+static void save_ppm(const char *filename) {
     FILE *f = fopen(filename, "wb");
     if (!f) {
         printf("Failed to create screenshot: %s\n", filename);
         return;
     }
     // P6 = Binary PPM, 240x160, 255 max val
-    fprintf(f, "P6\n%d %d\n255\n", GBA_SCREEN_WIDTH, GBA_SCREEN_HEIGHT);
-    
+    // Build the whole file in memory and write it in one call
+    static u8 ppm[32 + GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 3];
+    int len = sprintf((char *)ppm, "P6\n%d %d\n255\n", GBA_SCREEN_WIDTH, GBA_SCREEN_HEIGHT);
+    u8 *rgb = ppm + len;
     for (int i = 0; i < GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT; i++) {
         u32 color = internal_framebuffer[i];
         // Saved as ARGB8888 in buffer (from our render logic)
-        // PPM needs RGB
-        u8 r = (color >> 16) & 0xFF;
-        u8 g = (color >> 8) & 0xFF;
-        u8 b = color & 0xFF;
-        fputc(r, f);
-        fputc(g, f);
-        fputc(b, f);
+        rgb[i * 3 + 0] = (color >> 16) & 0xFF;
+        rgb[i * 3 + 1] = (color >> 8) & 0xFF;
+        rgb[i * 3 + 2] = color & 0xFF;
     }
+    fwrite(ppm, 1, len + GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 3, f);
     fclose(f);
     printf("Screenshot saved to %s\n", filename);
 }
 
+void ppu_save_screenshot(const char *filename) {
+    if (has_png_extension(filename)) {
+        if (png_write(filename, internal_framebuffer, GBA_SCREEN_WIDTH, GBA_SCREEN_HEIGHT)) {
+            printf("Screenshot saved to %s\n", filename);
+        }
+    } else {
+        save_ppm(filename);
+    }
+}
+
+void ppu_save_screenshot_async(const char *filename) {
+    if (has_png_extension(filename)) {
+        png_write_async(filename, internal_framebuffer, GBA_SCREEN_WIDTH, GBA_SCREEN_HEIGHT);
+    } else {
+        save_ppm(filename);
+    }
+}
+
+const u32 *ppu_get_framebuffer(void) { return internal_framebuffer; }
+
+u64 ppu_frame_hash(void) {
+    return frame_hash_xxh3(internal_framebuffer, sizeof(internal_framebuffer));
+}
+
 void ppu_update_texture(SDL_Texture *texture) {
   u16 *vram = (u16 *)memory_get_vram();
   u8 *io = memory_get_io();
@@ -358,26 +398,24 @@ void ppu_update_texture(SDL_Texture *texture) {
   u16 dispcnt = *(u16 *)&io[0];
   u8 mode = dispcnt & 7;
 
-  // Determine destination buffer
+  // Always render into the internal framebuffer so hashing and screenshots
+  // see the same frame in SDL and headless builds
   u32 *dst = internal_framebuffer;
-#ifdef USE_SDL
-  void *pixels = NULL;
-  int pitch = 0;
-  if (texture) {
-      if (SDL_LockTexture(texture, NULL, &pixels, &pitch) < 0) return;
-      dst = (u32 *)pixels;
-  }
-#endif
 
   // Render Frame
     if (mode == 0) {
         for (int y=0; y<GBA_SCREEN_HEIGHT; y++) {
+             STATS_TIME_BEGIN(bg_start);
              ppu_render_scanline_mode0(&dst[y * GBA_SCREEN_WIDTH], y);
+             STATS_TIME_END(bg_start, STATS_PPU_BACKGROUND);
+             STATS_TIME_BEGIN(obj_start);
              ppu_render_oam(&dst[y * GBA_SCREEN_WIDTH], y); 
+             STATS_TIME_END(obj_start, STATS_PPU_OBJECTS);
         }
     }
     else if (mode == 3) {
       // Mode 3: 240x160 15-bit Bitmap
+      STATS_TIME_BEGIN(bitmap_start);
       for (int i = 0; i < GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT; i++) {
         u16 color = vram[i];
         u8 r = (color & 0x1F) << 3;
@@ -385,7 +423,9 @@ void ppu_update_texture(SDL_Texture *texture) {
         u8 b = ((color >> 10) & 0x1F) << 3;
         dst[i] = (255 << 24) | (r << 16) | (g << 8) | b;
       }
+      STATS_TIME_END(bitmap_start, STATS_PPU_BITMAP);
     } else if (mode == 4) {
+      STATS_TIME_BEGIN(bitmap_start);
       u8 *page_ptr = (u8 *)vram;
       if (dispcnt & 0x10) page_ptr += 0xA000;
 
@@ -397,6 +437,7 @@ void ppu_update_texture(SDL_Texture *texture) {
         u8 b = ((color >> 10) & 0x1F) << 3;
         dst[i] = (255 << 24) | (r << 16) | (g << 8) | b;
       }
+      STATS_TIME_END(bitmap_start, STATS_PPU_BITMAP);
     } else {
         // Black
       for (int i = 0; i < GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT; i++) {
@@ -405,6 +446,15 @@ void ppu_update_texture(SDL_Texture *texture) {
     }
   
 #ifdef USE_SDL
-  if (texture) SDL_UnlockTexture(texture);
+  STATS_TIME_BEGIN(present_start);
+  void *pixels = NULL;
+  int pitch = 0;
+  if (texture && SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0) {
+      for (int y = 0; y < GBA_SCREEN_HEIGHT; y++) {
+          memcpy((u8 *)pixels + y * pitch, &dst[y * GBA_SCREEN_WIDTH], GBA_SCREEN_WIDTH * 4);
+      }
+      SDL_UnlockTexture(texture);
+  }
+  STATS_TIME_END(present_start, STATS_PPU_PRESENT);
 #endif
 }
@@ -0,0 +1,370 @@
+#include "../include/profiler.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool profiler_enabled = false;
+
+static u32 sample_interval = 1024;
+static u32 cycle_accum;
+
+// Shadow call stack: function entry and the address it returns to
+#define MAX_DEPTH 64
+typedef struct {
+  u32 target;
+  u32 ret;
+} Frame;
+static Frame stack[MAX_DEPTH];
+static int depth;
+
+// ---------------------------------------------------------------------------
+// Sample tables: distinct address sequences (call targets + leaf marker)
+// with their sample counts, in an open-addressing hash table
+
+typedef struct {
+  u64 hash;
+  u64 count;
+  u32 offset; // Into the frame pool
+  u32 length;
+} Entry;
+
+typedef struct {
+  Entry *slots;
+  u32 capacity;
+  u32 used;
+  u32 *pool;
+  u32 pool_used;
+  u32 pool_capacity;
+} Table;
+
+static Table stacks; // Folded stacks
+static Table pcs;    // Flat PC histogram (length 1)
+
+// Leaf of a sampled stack: the function holding the PC (with symbols),
+// or one of these markers
+#define NO_LEAF 0x00000000u
+#define HALTED_FRAME 0xFFFFFFFFu
+
+static u64 hash_frames(const u32 *frames, u32 length) {
+  u64 h = 0xCBF29CE484222325ull; // FNV-1a
+  for (u32 i = 0; i < length; i++) {
+    h ^= frames[i];
+    h *= 0x100000001B3ull;
+  }
+  return h | 1; // 0 marks an empty slot
+}
+
+static void table_free(Table *t) {
+  free(t->slots);
+  free(t->pool);
+  memset(t, 0, sizeof(*t));
+}
+
+static Entry *table_find(Table *t, u64 hash, const u32 *frames, u32 length) {
+  u32 i = (u32)hash & (t->capacity - 1);
+  while (t->slots[i].hash) {
+    Entry *e = &t->slots[i];
+    if (e->hash == hash && e->length == length &&
+        memcmp(&t->pool[e->offset], frames, length * sizeof(u32)) == 0) {
+      return e;
+    }
+    i = (i + 1) & (t->capacity - 1);
+  }
+  return &t->slots[i];
+}
+
+static bool table_grow(Table *t) {
+  u32 capacity = t->capacity ? t->capacity * 2 : 1024;
+  Entry *slots = calloc(capacity, sizeof(Entry));
+  if (!slots) return false;
+  for (u32 i = 0; i < t->capacity; i++) {
+    Entry *e = &t->slots[i];
+    if (!e->hash) continue;
+    u32 j = (u32)e->hash & (capacity - 1);
+    while (slots[j].hash) j = (j + 1) & (capacity - 1);
+    slots[j] = *e;
+  }
+  free(t->slots);
+  t->slots = slots;
+  t->capacity = capacity;
+  return true;
+}
+
+static void table_add(Table *t, const u32 *frames, u32 length, u64 weight) {
+  if (t->used * 10 >= t->capacity * 7 && !table_grow(t)) return;
+  u64 hash = hash_frames(frames, length);
+  Entry *e = table_find(t, hash, frames, length);
+  if (e->hash) {
+    e->count += weight;
+    return;
+  }
+  if (t->pool_used + length > t->pool_capacity) {
+    u32 capacity = t->pool_capacity ? t->pool_capacity * 2 : 4096;
+    while (capacity < t->pool_used + length) capacity *= 2;
+    u32 *pool = realloc(t->pool, capacity * sizeof(u32));
+    if (!pool) return;
+    t->pool = pool;
+    t->pool_capacity = capacity;
+  }
+  memcpy(&t->pool[t->pool_used], frames, length * sizeof(u32));
+  e->hash = hash;
+  e->count = weight;
+  e->offset = t->pool_used;
+  e->length = length;
+  t->pool_used += length;
+  t->used++;
+}
+
+// ---------------------------------------------------------------------------
+// Symbols
+
+typedef struct {
+  u32 addr;
+  char *name;
+} Symbol;
+
+static Symbol *symbols;
+static u32 symbol_count;
+static u32 symbol_capacity;
+
+static void add_symbol(u32 addr, const char *name, size_t len) {
+  if (symbol_count == symbol_capacity) {
+    u32 capacity = symbol_capacity ? symbol_capacity * 2 : 256;
+    Symbol *grown = realloc(symbols, capacity * sizeof(Symbol));
+    if (!grown) return;
+    symbols = grown;
+    symbol_capacity = capacity;
+  }
+  char *copy = malloc(len + 1);
+  if (!copy) return;
+  memcpy(copy, name, len);
+  copy[len] = '\0';
+  symbols[symbol_count].addr = addr & ~1u; // Thumb bit
+  symbols[symbol_count].name = copy;
+  symbol_count++;
+}
+
+static int compare_symbols(const void *a, const void *b) {
+  u32 x = ((const Symbol *)a)->addr, y = ((const Symbol *)b)->addr;
+  return (x > y) - (x < y);
+}
+
+static u32 read_le32(const u8 *p) { return p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24; }
+static u16 read_le16(const u8 *p) { return p[0] | p[1] << 8; }
+
+// ELF32 little-endian: FUNC entries of every SHT_SYMTAB section
+static void load_elf_symbols(const u8 *data, size_t size) {
+  if (size < 0x34) return;
+  u32 shoff = read_le32(&data[0x20]);
+  u16 shentsize = read_le16(&data[0x2E]);
+  u16 shnum = read_le16(&data[0x30]);
+  if (shentsize < 0x28 || shoff > size || (size_t)shnum * shentsize > size - shoff) return;
+
+  for (u16 i = 0; i < shnum; i++) {
+    const u8 *sh = &data[shoff + i * shentsize];
+    if (read_le32(&sh[0x04]) != 2) continue; // SHT_SYMTAB
+    u32 offset = read_le32(&sh[0x10]);
+    u32 length = read_le32(&sh[0x14]);
+    u32 link = read_le32(&sh[0x18]);
+    if (link >= shnum || offset > size || length > size - offset) continue;
+    const u8 *strsh = &data[shoff + link * shentsize];
+    u32 stroff = read_le32(&strsh[0x10]);
+    u32 strsize = read_le32(&strsh[0x14]);
+    if (stroff > size || strsize > size - stroff) continue;
+
+    for (u32 s = 0; s + 16 <= length; s += 16) {
+      const u8 *sym = &data[offset + s];
+      u32 name = read_le32(&sym[0]);
+      if ((sym[12] & 0xF) != 2 || name >= strsize) continue; // STT_FUNC
+      const char *str = (const char *)&data[stroff + name];
+      add_symbol(read_le32(&sym[4]), str, strnlen(str, strsize - name));
+    }
+  }
+}
+
+static bool is_symbol_start(char c) { return isalpha((unsigned char)c) || c == '_' || c == '.' || c == '$'; }
+
+// "0x08000200 main", "08000200 main" or nm's "08000200 T main"
+static void load_text_symbols(char *text) {
+  for (char *line = strtok(text, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+    char *tokens[4];
+    int n = 0;
+    for (char *p = line; *p && n < 4;) {
+      while (*p == ' ' || *p == '\t') p++;
+      if (!*p) break;
+      tokens[n++] = p;
+      while (*p && *p != ' ' && *p != '\t') p++;
+      if (*p) *p++ = '\0';
+    }
+    if (n == 3 && strlen(tokens[1]) == 1) tokens[1] = tokens[2], n = 2;
+    if (n != 2 || !is_symbol_start(tokens[1][0])) continue;
+    char *end;
+    unsigned long addr = strtoul(tokens[0], &end, 16);
+    if (*end || addr == 0 || addr > 0x0FFFFFFF) continue;
+    add_symbol((u32)addr, tokens[1], strlen(tokens[1]));
+  }
+}
+
+bool profiler_load_symbols(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    printf("Failed to open symbol file: %s\n", path);
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  u8 *data = malloc(size + 1);
+  if (!data || fread(data, 1, size, f) != (size_t)size) {
+    fclose(f);
+    free(data);
+    return false;
+  }
+  fclose(f);
+  data[size] = '\0';
+
+  if (size >= 4 && memcmp(data, "\x7F" "ELF", 4) == 0) {
+    load_elf_symbols(data, size);
+  } else {
+    load_text_symbols((char *)data);
+  }
+  free(data);
+  qsort(symbols, symbol_count, sizeof(Symbol), compare_symbols);
+  printf("[Profiler] Loaded %u symbols from %s\n", symbol_count, path);
+  return true;
+}
+
+// Last symbol at or below addr
+static const Symbol *find_symbol(u32 addr) {
+  u32 lo = 0, hi = symbol_count;
+  while (lo < hi) {
+    u32 mid = (lo + hi) / 2;
+    if (symbols[mid].addr <= addr) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo ? &symbols[lo - 1] : NULL;
+}
+
+const char *profiler_symbol(u32 addr) {
+  const Symbol *s = find_symbol(addr);
+  return s ? s->name : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Call tracking and sampling
+
+void profiler_init(u32 interval) {
+  sample_interval = interval ? interval : 1;
+  profiler_reset();
+  profiler_enabled = true;
+}
+
+void profiler_reset(void) {
+  table_free(&stacks);
+  table_free(&pcs);
+  depth = 0;
+  cycle_accum = 0;
+}
+
+// Calls past MAX_DEPTH go unrecorded and are charged to the deepest frame
+static void push(u32 target, u32 ret) {
+  if (depth == MAX_DEPTH) return;
+  stack[depth].target = target;
+  stack[depth].ret = ret & ~1u;
+  depth++;
+}
+
+void profiler_exception(u32 vector, u32 ret) { push(vector, ret); }
+
+void profiler_branch(ARM7TDMI *cpu, u32 from) {
+  u32 to = cpu->r[REG_PC];
+  for (int i = depth - 1; i >= 0; i--) {
+    if (stack[i].ret == to) {
+      depth = i;
+      return;
+    }
+  }
+  u32 lr = cpu->r[REG_LR] & ~1u;
+  if (lr != to && (lr == from + 4 || lr == from + 2)) push(to, lr);
+}
+
+void profiler_sample(ARM7TDMI *cpu, int cycles) {
+  cycle_accum += cycles;
+  if (cycle_accum < sample_interval) return;
+  u64 weight = cycle_accum / sample_interval;
+  cycle_accum %= sample_interval;
+
+  u32 pc = cpu->r[REG_PC];
+  u32 frames[MAX_DEPTH + 1];
+  int n = 0;
+  for (int i = 0; i < depth; i++) frames[n++] = stack[i].target;
+  const Symbol *leaf = find_symbol(pc);
+  frames[n++] = cpu->halted ? HALTED_FRAME : leaf ? leaf->addr : NO_LEAF;
+  table_add(&stacks, frames, n, weight);
+  table_add(&pcs, &pc, 1, weight);
+}
+
+// Function name for a call target; "sub_XXXXXXXX" without symbols
+static void frame_name(u32 addr, char *buf, size_t size) {
+  const char *sym = profiler_symbol(addr);
+  if (sym) snprintf(buf, size, "%s", sym);
+  else snprintf(buf, size, "sub_%08X", addr);
+}
+
+static int compare_counts(const void *a, const void *b) {
+  u64 x = (*(const Entry *const *)a)->count, y = (*(const Entry *const *)b)->count;
+  return (x < y) - (x > y);
+}
+
+bool profiler_write(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    printf("Failed to open profile output: %s\n", path);
+    return false;
+  }
+  char name[128];
+  u64 total = 0;
+  for (u32 i = 0; i < stacks.capacity; i++) {
+    const Entry *e = &stacks.slots[i];
+    if (!e->hash) continue;
+    const u32 *frames = &stacks.pool[e->offset];
+    u32 calls = e->length - 1;
+    u32 leaf = frames[calls];
+
+    fprintf(f, "root");
+    for (u32 k = 0; k < calls; k++) {
+      frame_name(frames[k], name, sizeof(name));
+      fprintf(f, ";%s", name);
+    }
+    // The leaf adds a frame only when the PC sits in a different function
+    // than the innermost call (code reached by a plain branch)
+    if (leaf == HALTED_FRAME) {
+      fprintf(f, ";[halted]");
+    } else if (leaf != NO_LEAF && (!calls || profiler_symbol(leaf) != profiler_symbol(frames[calls - 1]))) {
+      fprintf(f, ";%s", profiler_symbol(leaf));
+    }
+    fprintf(f, " %llu\n", (unsigned long long)e->count);
+    total += e->count;
+  }
+  fclose(f);
+
+  // Hottest PCs: candidates for HLE or idle-loop detection
+  Entry **sorted = malloc(pcs.used * sizeof(Entry *));
+  if (sorted) {
+    u32 n = 0;
+    for (u32 i = 0; i < pcs.capacity; i++) {
+      if (pcs.slots[i].hash) sorted[n++] = &pcs.slots[i];
+    }
+    qsort(sorted, n, sizeof(Entry *), compare_counts);
+    printf("[Profiler] %llu samples every %u cycles -> %s\n", (unsigned long long)total, sample_interval, path);
+    for (u32 i = 0; i < n && i < 10; i++) {
+      u32 pc = pcs.pool[sorted[i]->offset];
+      const char *sym = profiler_symbol(pc);
+      printf("[Profiler] %5.1f%% %08X %s\n", total ? 100.0 * sorted[i]->count / total : 0.0, pc,
+             sym ? sym : "");
+    }
+    free(sorted);
+  }
+  return true;
+}
@@ -0,0 +1,54 @@
+#include "../include/scheduler.h"
+#include <string.h>
+
+static u64 now;
+static u64 event_time[SCHED_EVENT_COUNT];
+static SchedCallback event_callback[SCHED_EVENT_COUNT];
+static u64 next_event; // Cached minimum of event_time
+
+static void update_next_event(void) {
+  next_event = SCHED_NEVER;
+  for (int i = 0; i < SCHED_EVENT_COUNT; i++) {
+    if (event_time[i] < next_event) next_event = event_time[i];
+  }
+}
+
+void scheduler_init(void) {
+  now = 0;
+  for (int i = 0; i < SCHED_EVENT_COUNT; i++) event_time[i] = SCHED_NEVER;
+  memset(event_callback, 0, sizeof(event_callback));
+  next_event = SCHED_NEVER;
+}
+
+void scheduler_register(SchedEvent event, SchedCallback callback) { event_callback[event] = callback; }
+
+u64 scheduler_now(void) { return now; }
+
+u64 scheduler_next_event(void) { return next_event; }
+
+void scheduler_schedule(SchedEvent event, u64 when) {
+  event_time[event] = when;
+  if (when < next_event) next_event = when;
+  else update_next_event();
+}
+
+void scheduler_cancel(SchedEvent event) {
+  if (event_time[event] == SCHED_NEVER) return;
+  event_time[event] = SCHED_NEVER;
+  update_next_event();
+}
+
+void scheduler_advance(int cycles) {
+  now += cycles;
+  // Callbacks may reschedule themselves (possibly still <= now)
+  while (next_event <= now) {
+    int first = 0;
+    for (int i = 1; i < SCHED_EVENT_COUNT; i++) {
+      if (event_time[i] < event_time[first]) first = i;
+    }
+    u64 when = event_time[first];
+    event_time[first] = SCHED_NEVER;
+    update_next_event();
+    if (event_callback[first]) event_callback[first]((SchedEvent)first, when);
+  }
+}
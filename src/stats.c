@@ -0,0 +1,128 @@
+#include "../include/stats.h"
+
+#ifdef GBA_STATS
+
+#include "../include/cpu.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+_Thread_local Stats gba_stats;
+
+static const char *dump_path;
+static volatile sig_atomic_t dump_requested;
+
+static const char *ppu_stage_names[STATS_PPU_STAGES] = {"background", "objects", "bitmap", "present"};
+static const char *width_names[3] = {"8", "16", "32"};
+
+u64 stats_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void stats_reset(void) { memset(&gba_stats, 0, sizeof(gba_stats)); }
+
+// Sum dispatch slots per handler: names come back as the same pointers, so
+// a short linear scan groups them
+#define MAX_HANDLERS 32
+static void write_handlers(FILE *f, const u64 *ops, u32 count, const char *(*name_of)(u32)) {
+  const char *names[MAX_HANDLERS];
+  u64 totals[MAX_HANDLERS];
+  int n = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (!ops[i]) continue;
+    const char *name = name_of(i);
+    int k = 0;
+    while (k < n && names[k] != name) k++;
+    if (k == n) {
+      if (n == MAX_HANDLERS) continue;
+      names[n] = name;
+      totals[n++] = 0;
+    }
+    totals[k] += ops[i];
+  }
+  fprintf(f, "{");
+  for (int k = 0; k < n; k++) {
+    fprintf(f, "%s\"%s\": %llu", k ? ", " : "", names[k], (unsigned long long)totals[k]);
+  }
+  fprintf(f, "}");
+}
+
+bool stats_write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    printf("Failed to open stats file: %s\n", path);
+    return false;
+  }
+  const Stats *s = &gba_stats;
+
+  fprintf(f, "{\n  \"arm_handlers\": ");
+  write_handlers(f, s->arm_ops, 4096, cpu_arm_handler_name);
+  fprintf(f, ",\n  \"thumb_handlers\": ");
+  write_handlers(f, s->thumb_ops, 1024, cpu_thumb_handler_name);
+
+  fprintf(f, ",\n  \"bus\": {");
+  bool first = true;
+  for (int r = 0; r < 256; r++) {
+    const u64 *w = s->bus[r];
+    if (!w[0] && !w[1] && !w[2]) continue;
+    fprintf(f, "%s\"%02X\": {", first ? "" : ", ", r);
+    for (int i = 0; i < 3; i++) {
+      fprintf(f, "%s\"%s\": %llu", i ? ", " : "", width_names[i], (unsigned long long)w[i]);
+    }
+    fprintf(f, "}");
+    first = false;
+  }
+
+  fprintf(f, "},\n  \"halted_cycles\": %llu", (unsigned long long)s->halted_cycles);
+  fprintf(f, ",\n  \"dma_bytes\": [%llu, %llu, %llu, %llu]", (unsigned long long)s->dma_bytes[0],
+          (unsigned long long)s->dma_bytes[1], (unsigned long long)s->dma_bytes[2],
+          (unsigned long long)s->dma_bytes[3]);
+
+  fprintf(f, ",\n  \"swi\": {");
+  first = true;
+  for (int i = 0; i < 256; i++) {
+    if (!s->swi[i]) continue;
+    fprintf(f, "%s\"%02X\": %llu", first ? "" : ", ", i, (unsigned long long)s->swi[i]);
+    first = false;
+  }
+
+  fprintf(f, "},\n  \"ppu_ns\": {");
+  for (int i = 0; i < STATS_PPU_STAGES; i++) {
+    fprintf(f, "%s\"%s\": %llu", i ? ", " : "", ppu_stage_names[i], (unsigned long long)s->ppu_ns[i]);
+  }
+  fprintf(f, "}\n}\n");
+  fclose(f);
+  return true;
+}
+
+static void dump_at_exit(void) {
+  if (stats_write_json(dump_path)) printf("[Stats] Wrote %s\n", dump_path);
+}
+
+#ifdef SIGUSR1
+// Only a flag here: the JSON is written from the emulation thread
+static void on_signal(int sig) {
+  (void)sig;
+  dump_requested = 1;
+}
+#endif
+
+void stats_install(const char *path) {
+  dump_path = path;
+  atexit(dump_at_exit);
+#ifdef SIGUSR1
+  signal(SIGUSR1, on_signal);
+#endif
+}
+
+void stats_poll(void) {
+  if (!dump_requested) return;
+  dump_requested = 0;
+  if (stats_write_json(dump_path)) printf("[Stats] Wrote %s\n", dump_path);
+}
+
+#endif
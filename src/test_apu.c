@@ -0,0 +1,134 @@
+#include "../include/apu.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CYCLES_PER_SECOND 16777216
+
+static s16 samples[60000 * 2];
+
+static void reset(void) {
+    memory_init();
+    apu_init();
+    bus_write16(0x04000084, 0x0080); // Master enable
+}
+
+void test_square_440hz() {
+    printf("Testing APU Square 440 Hz...\n");
+    reset();
+    bus_write16(0x04000080, 0x2277); // Ch2 left/right, master volume 7
+    bus_write16(0x04000082, 0x0002); // PSG 100%
+    bus_write16(0x04000068, 0xF080); // Volume 15, duty 50%
+    bus_write16(0x0400006C, 0x8000 | 1750); // Trigger, 131072 / (2048 - 1750) = 440 Hz
+
+    // Drain as we go: the ring only holds a fraction of a second
+    int n = 0;
+    for (int i = 0; i < CYCLES_PER_SECOND; i += 1024) {
+        apu_step(1024);
+        n += apu_read_samples(samples + n * 2, 60000 - n);
+    }
+    if (n < 47900 || n > 48000) {
+        printf("FAIL: Expected ~48000 samples for 1s, got %d\n", n);
+        return;
+    }
+    printf("PASS: %d samples per second\n", n);
+
+    int crossings = 0;
+    for (int i = 1; i < n; i++) {
+        if ((samples[(i - 1) * 2] < 0) != (samples[i * 2] < 0)) crossings++;
+    }
+    if (crossings < 870 || crossings > 890) {
+        printf("FAIL: Expected ~880 zero crossings, got %d\n", crossings);
+    } else {
+        printf("PASS: %d zero crossings (440 Hz)\n", crossings);
+    }
+
+    u8 status = bus_read8(0x04000084);
+    if (!(status & 0x02)) printf("FAIL: SOUNDCNT_X ch2 status not set (%02X)\n", status);
+    else printf("PASS: SOUNDCNT_X reports ch2 on\n");
+}
+
+void test_fifo_sound_dma() {
+    printf("Testing APU FIFO A via Sound DMA...\n");
+    reset();
+    // DMA A 100%, left/right, timer 0
+    bus_write16(0x04000082, 0x0304);
+    for (int i = 0; i < 64; i++) bus_write8(0x02000000 + i, 0x40);
+
+    bus_write32(0x040000BC, 0x02000000);              // DMA1SAD
+    bus_write32(0x040000C0, APU_FIFO_A);              // DMA1DAD
+    bus_write16(0x040000C6, 0x8000 | 0x3000 | 0x0600); // Enable, sound timing, 32-bit, repeat
+
+    // First overflow finds the FIFO empty and pulls 16 bytes
+    for (int i = 0; i < 4; i++) {
+        apu_timer_overflow(0);
+        apu_step(APU_CYCLES_PER_MIX * 16);
+    }
+    apu_step(APU_CYCLES_PER_MIX * 64);
+
+    int n = apu_read_samples(samples, 60000);
+    // 0x40 * 4 = 256 above the bias, scaled x64
+    s16 last = samples[(n - 1) * 2];
+    if (n == 0 || abs(last - 16384) > 256) {
+        printf("FAIL: Expected FIFO level ~16384, got %d (%d samples)\n", last, n);
+    } else {
+        printf("PASS: FIFO sample reaches output (%d)\n", last);
+    }
+
+    u16 cnt = bus_read16(0x040000C6);
+    if (!(cnt & 0x8000)) printf("FAIL: Repeating sound DMA was disabled\n");
+    else printf("PASS: Sound DMA stays armed\n");
+}
+
+void test_wav_output() {
+    printf("Testing APU WAV Output...\n");
+    reset();
+    const char *path = "test_apu.wav";
+    if (!apu_wav_open(path)) {
+        printf("FAIL: Could not open WAV\n");
+        return;
+    }
+    apu_step(CYCLES_PER_SECOND / 10);
+    apu_wav_close();
+
+    FILE *f = fopen(path, "rb");
+    u8 h[44];
+    size_t got = f ? fread(h, 1, sizeof(h), f) : 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    remove(path);
+
+    u32 data_bytes = h[40] | (h[41] << 8) | (h[42] << 16) | ((u32)h[43] << 24);
+    u32 rate = h[24] | (h[25] << 8) | (h[26] << 16) | ((u32)h[27] << 24);
+    if (got != 44 || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVEfmt ", 8) || rate != APU_OUTPUT_RATE) {
+        printf("FAIL: WAV header\n");
+    } else if (data_bytes + 44 != (u32)size || data_bytes < 4700 * 4) {
+        printf("FAIL: WAV data size %u (file %ld)\n", data_bytes, size);
+    } else {
+        printf("PASS: WAV header and %u data bytes\n", data_bytes);
+    }
+}
+
+void test_master_disable() {
+    printf("Testing APU Master Disable...\n");
+    reset();
+    bus_write16(0x04000080, 0x2277);
+    bus_write16(0x04000082, 0x0306); // PSG 100%, DMA A full volume on both sides
+    bus_write16(0x04000084, 0x0000);
+    u16 cnt_l = bus_read16(0x04000080);
+    u16 cnt_h = bus_read16(0x04000082);
+    if (cnt_l != 0) printf("FAIL: SOUNDCNT_L %04X after master disable\n", cnt_l);
+    else printf("PASS: SOUNDCNT_L cleared by master disable\n");
+    if (cnt_h != 0x0306) printf("FAIL: SOUNDCNT_H %04X after master disable\n", cnt_h);
+    else printf("PASS: SOUNDCNT_H kept across master disable\n");
+}
+
+int main() {
+    test_square_440hz();
+    test_fifo_sound_dma();
+    test_wav_output();
+    test_master_disable();
+    return 0;
+}
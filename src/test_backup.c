@@ -0,0 +1,123 @@
+#include "../include/backup.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SAVE_PATH "test_backup.sav"
+
+void test_detect() {
+    printf("Testing Backup Detection...\n");
+    static u8 rom[0x400];
+    memset(rom, 0, sizeof(rom));
+    if (backup_detect(rom, sizeof(rom)) != BACKUP_NONE) printf("FAIL: Empty ROM detected backup\n");
+    memcpy(&rom[0x200], "FLASH1M_V103", 12);
+    if (backup_detect(rom, sizeof(rom)) != BACKUP_FLASH128) printf("FAIL: FLASH1M_V\n");
+    else printf("PASS: FLASH1M_V -> Flash 128KB\n");
+    memcpy(&rom[0x100], "SRAM_V113", 9);
+    if (backup_detect(rom, sizeof(rom)) != BACKUP_SRAM) printf("FAIL: SRAM_V\n");
+    else printf("PASS: SRAM_V -> SRAM\n");
+}
+
+void test_sram_persistence() {
+    printf("Testing SRAM Persistence...\n");
+    remove(SAVE_PATH);
+    memory_init();
+    backup_init(BACKUP_SRAM, SAVE_PATH);
+    if (bus_read8(0x0E000010) != 0xFF) printf("FAIL: New save not erased\n");
+    bus_write8(0x0E000010, 0x5A);
+    bus_write16(0x0E000011, 0xA500); // Odd address: upper byte
+    backup_close();
+
+    FILE *f = fopen(SAVE_PATH, "rb");
+    u8 buf[0x20];
+    size_t n = f ? fread(buf, 1, sizeof(buf), f) : 0;
+    if (f) fclose(f);
+    if (n != sizeof(buf) || buf[0x10] != 0x5A || buf[0x11] != 0xA5) {
+        printf("FAIL: Writes not in .sav file\n");
+    } else {
+        printf("PASS: Writes reach the .sav without flushing\n");
+    }
+
+    backup_init(BACKUP_SRAM, SAVE_PATH);
+    if (bus_read16(0x0E000010) != 0x5A5A) printf("FAIL: Reload / lane mirroring\n");
+    else printf("PASS: Reloaded save, byte repeated on 16-bit read\n");
+    backup_close();
+    remove(SAVE_PATH);
+}
+
+static void flash_cmd(u8 cmd) {
+    bus_write8(0x0E005555, 0xAA);
+    bus_write8(0x0E002AAA, 0x55);
+    bus_write8(0x0E005555, cmd);
+}
+
+void test_flash() {
+    printf("Testing Flash 128KB...\n");
+    memory_init();
+    backup_init(BACKUP_FLASH128, NULL);
+
+    flash_cmd(0x90);
+    u8 maker = bus_read8(0x0E000000), device = bus_read8(0x0E000001);
+    flash_cmd(0xF0);
+    if (maker != 0x62 || device != 0x13) printf("FAIL: ID %02X/%02X\n", maker, device);
+    else printf("PASS: Sanyo ID 62/13\n");
+
+    flash_cmd(0xA0);
+    bus_write8(0x0E001234, 0x42);
+    flash_cmd(0xB0);
+    bus_write8(0x0E000000, 1); // Bank 1
+    flash_cmd(0xA0);
+    bus_write8(0x0E001234, 0x99);
+    if (bus_read8(0x0E001234) != 0x99) printf("FAIL: Bank 1 program\n");
+    flash_cmd(0xB0);
+    bus_write8(0x0E000000, 0);
+    if (bus_read8(0x0E001234) != 0x42) printf("FAIL: Bank 0 program\n");
+    else printf("PASS: Program byte in both banks\n");
+
+    flash_cmd(0x80);
+    bus_write8(0x0E005555, 0xAA);
+    bus_write8(0x0E002AAA, 0x55);
+    bus_write8(0x0E001000, 0x30); // Erase sector 1 in bank 0
+    if (bus_read8(0x0E001234) != 0xFF) printf("FAIL: Sector erase\n");
+    else printf("PASS: Sector erase\n");
+    backup_close();
+}
+
+static void eeprom_bits(u32 value, int n) {
+    for (int i = n - 1; i >= 0; i--) bus_write16(0x0D000000, (value >> i) & 1);
+}
+
+void test_eeprom() {
+    printf("Testing EEPROM 8KB...\n");
+    memory_init();
+    backup_init(BACKUP_EEPROM, NULL);
+    backup_eeprom_hint(81);
+
+    // Write block 5: 10 <14-bit addr> <64 bits> 0
+    eeprom_bits(2, 2);
+    eeprom_bits(5, 14);
+    eeprom_bits(0x01234567, 32);
+    eeprom_bits(0x89ABCDEF, 32);
+    eeprom_bits(0, 1);
+    if (bus_read16(0x0D000000) != 1) printf("FAIL: Not ready after write\n");
+
+    // Read block 5: 11 <addr> 0, then 4 dummy + 64 data bits
+    eeprom_bits(3, 2);
+    eeprom_bits(5, 14);
+    eeprom_bits(0, 1);
+    u32 hi = 0, lo = 0;
+    for (int i = 0; i < 4; i++) bus_read16(0x0D000000);
+    for (int i = 0; i < 32; i++) hi = (hi << 1) | (bus_read16(0x0D000000) & 1);
+    for (int i = 0; i < 32; i++) lo = (lo << 1) | (bus_read16(0x0D000000) & 1);
+    if (hi != 0x01234567 || lo != 0x89ABCDEF) printf("FAIL: EEPROM read %08X%08X\n", hi, lo);
+    else printf("PASS: EEPROM serial write/read\n");
+    backup_close();
+}
+
+int main() {
+    test_detect();
+    test_sram_persistence();
+    test_flash();
+    test_eeprom();
+    return 0;
+}
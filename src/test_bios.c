@@ -0,0 +1,574 @@
+#include "../include/bios.h"
+#include "../include/cpu.h"
+#include "../include/memory.h"
+#include "../include/io.h"
+#include "../include/ppu.h"
+#include <stdio.h>
+#include <string.h>
+
+static void put_bytes(u32 addr, const u8 *data, int len) {
+    for (int i = 0; i < len; i++) bus_write8(addr + i, data[i]);
+}
+
+static bool check_bytes(u32 addr, const u8 *expect, int len) {
+    for (int i = 0; i < len; i++) {
+        if (bus_read8(addr + i) != expect[i]) return false;
+    }
+    return true;
+}
+
+static void run_swi(u8 number, u32 r0, u32 r1, u32 r2) {
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.r[0] = r0;
+    cpu.r[1] = r1;
+    cpu.r[2] = r2;
+    bios_handle_swi(&cpu, number);
+}
+
+// "ABC" + (length 9, distance 3) + "X"
+static const u8 lz_overlap[] = {0x10, 0x0D, 0x00, 0x00, 0x10, 'A', 'B', 'C', 0x60, 0x02, 'X'};
+// "01234567" + (length 8, distance 8)
+static const u8 lz_words[] = {0x10, 0x10, 0x00, 0x00, 0x00, '0', '1', '2', '3',
+                              '4',  '5',  '6',  '7',  0x80, 0x50, 0x07};
+// "A" + (length 3, distance 1)
+static const u8 lz_repeat[] = {0x10, 0x04, 0x00, 0x00, 0x40, 'A', 0x00, 0x00};
+
+void test_lz77_wram() {
+    printf("Testing LZ77UnCompWram...\n");
+    memory_init();
+
+    put_bytes(0x02010000, lz_overlap, sizeof(lz_overlap));
+    run_swi(0x11, 0x02010000, 0x02020000, 0);
+    if (!check_bytes(0x02020000, (const u8 *)"ABCABCABCABCX", 13)) printf("FAIL: Overlapping reference\n");
+    else printf("PASS: Overlapping reference\n");
+
+    put_bytes(0x02010000, lz_words, sizeof(lz_words));
+    bus_cycles = 0;
+    run_swi(0x11, 0x02010000, 0x02020000, 0);
+    if (!check_bytes(0x02020000, (const u8 *)"0123456701234567", 16)) printf("FAIL: Word-sized reference\n");
+    else printf("PASS: Word-sized reference\n");
+    if (bus_cycles <= 0) printf("FAIL: No cycles charged\n");
+    else printf("PASS: Charged %d cycles\n", bus_cycles);
+
+    put_bytes(0x02010000, lz_repeat, sizeof(lz_repeat));
+    run_swi(0x11, 0x02010000, 0x02020000, 0);
+    if (!check_bytes(0x02020000, (const u8 *)"AAAA", 4)) printf("FAIL: Distance-1 run\n");
+    else printf("PASS: Distance-1 run\n");
+}
+
+void test_lz77_vram() {
+    printf("Testing LZ77UnCompVram...\n");
+    memory_init();
+
+    put_bytes(0x02010000, lz_words, sizeof(lz_words));
+    run_swi(0x12, 0x02010000, 0x06000000, 0);
+    if (!check_bytes(0x06000000, (const u8 *)"0123456701234567", 16)) printf("FAIL: VRAM output\n");
+    else printf("PASS: VRAM output\n");
+
+    // Halfword writes: the odd byte copies the old VRAM byte, not 'A'
+    bus_write32(0x06000100, 0xEEEEEEEE);
+    put_bytes(0x02010000, lz_repeat, sizeof(lz_repeat));
+    run_swi(0x12, 0x02010000, 0x06000100, 0);
+    const u8 stale[] = {'A', 0xEE, 0xEE, 0xEE};
+    if (!check_bytes(0x06000100, stale, 4)) printf("FAIL: Distance-1 reads pending halfword\n");
+    else printf("PASS: Distance-1 reads pending halfword\n");
+}
+
+void test_lz77_bus_fallback() {
+    printf("Testing LZ77 Bus Fallback...\n");
+    memory_init();
+
+    // Output wraps from the end of EWRAM into its mirror at 0x02040000
+    put_bytes(0x02010000, lz_words, sizeof(lz_words));
+    run_swi(0x11, 0x02010000, 0x0203FFF8, 0);
+    if (!check_bytes(0x0203FFF8, (const u8 *)"01234567", 8) ||
+        !check_bytes(0x02000000, (const u8 *)"01234567", 8))
+        printf("FAIL: Region-crossing output\n");
+    else printf("PASS: Region-crossing output\n");
+
+    bus_write32(0x06000100, 0xEEEEEEEE);
+    put_bytes(0x0203FFFC, lz_repeat, sizeof(lz_repeat));
+    run_swi(0x12, 0x0203FFFC, 0x06000100, 0);
+    const u8 stale[] = {'A', 0xEE, 0xEE, 0xEE};
+    if (!check_bytes(0x06000100, stale, 4)) printf("FAIL: Region-crossing stream to VRAM\n");
+    else printf("PASS: Region-crossing stream to VRAM\n");
+
+    // Last token is a reference clipped to one byte: the stream is one byte
+    // longer than all literals and its final byte wraps into the mirror
+    const u8 lz_clipped[] = {0x10, 0x03, 0x00, 0x00, 0x20, 'A', 'B', 0x00};
+    put_bytes(0x0203FFF8, lz_clipped, sizeof(lz_clipped));
+    bus_write8(0x02000000, 0x01); // Displacement 2
+    run_swi(0x11, 0x0203FFF8, 0x02010000, 0);
+    if (!check_bytes(0x02010000, (const u8 *)"ABA", 3)) printf("FAIL: Clipped final reference at region end\n");
+    else printf("PASS: Clipped final reference at region end\n");
+}
+
+void test_rl_uncomp() {
+    printf("Testing RLUnComp...\n");
+    memory_init();
+
+    // Run of 5 'A', then literal "BCD"
+    const u8 rle[] = {0x30, 0x08, 0x00, 0x00, 0x82, 'A', 0x02, 'B', 'C', 'D'};
+    put_bytes(0x02010000, rle, sizeof(rle));
+    run_swi(0x14, 0x02010000, 0x02020000, 0);
+    if (!check_bytes(0x02020000, (const u8 *)"AAAAABCD", 8)) printf("FAIL: RLUnCompWram\n");
+    else printf("PASS: RLUnCompWram\n");
+
+    // Output wraps from the end of VRAM into its mirror (halfword bus path)
+    run_swi(0x15, 0x02010000, 0x06017FFC, 0);
+    if (!check_bytes(0x06017FFC, (const u8 *)"AAAA", 4) ||
+        !check_bytes(0x06010000, (const u8 *)"ABCD", 4))
+        printf("FAIL: RLUnCompVram across the VRAM mirror\n");
+    else printf("PASS: RLUnCompVram across the VRAM mirror\n");
+}
+
+void test_diff_unfilter() {
+    printf("Testing Diff UnFilter...\n");
+    memory_init();
+
+    const u8 diff8[] = {0x81, 0x04, 0x00, 0x00, 0x01, 0x01, 0x01, 0xFF};
+    const u8 expect8[] = {1, 2, 3, 2};
+    put_bytes(0x02010000, diff8, sizeof(diff8));
+    run_swi(0x16, 0x02010000, 0x02020000, 0);
+    bool ok = check_bytes(0x02020000, expect8, 4);
+    run_swi(0x17, 0x02010000, 0x06000000, 0);
+    ok = ok && check_bytes(0x06000000, expect8, 4);
+    if (!ok) printf("FAIL: Diff8bitUnFilter\n");
+    else printf("PASS: Diff8bitUnFilter Wram/Vram\n");
+
+    const u8 diff16[] = {0x82, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0xFF, 0xFF};
+    put_bytes(0x02010000, diff16, sizeof(diff16));
+    run_swi(0x18, 0x02010000, 0x02020000, 0);
+    if (bus_read16(0x02020000) != 0x100 || bus_read16(0x02020002) != 0x200 ||
+        bus_read16(0x02020004) != 0x1FF)
+        printf("FAIL: Diff16bitUnFilter\n");
+    else printf("PASS: Diff16bitUnFilter\n");
+}
+
+// Append `len` bits of `code` to a most-significant-bit-first word stream
+static void push_bits(u32 *words, u32 *pos, u32 code, u32 len) {
+    for (u32 i = 0; i < len; i++, (*pos)++) {
+        if ((code >> (len - 1 - i)) & 1) words[*pos / 32] |= 0x80000000u >> (*pos % 32);
+    }
+}
+
+void test_huff_uncomp() {
+    printf("Testing HuffUnComp...\n");
+    memory_init();
+
+    // A = 0, B = 10, C = 11; tree padded to a word boundary
+    const u8 small[] = {0x28, 0x04, 0x00, 0x00, 0x03, 0x80, 'A', 0xC0, 'B', 'C', 0x00, 0x00};
+    u32 word = 0, pos = 0;
+    push_bits(&word, &pos, 0, 1);
+    push_bits(&word, &pos, 2, 2);
+    push_bits(&word, &pos, 3, 2);
+    push_bits(&word, &pos, 0, 1);
+    put_bytes(0x02010000, small, sizeof(small));
+    bus_write32(0x0201000C, word);
+    run_swi(0x13, 0x02010000, 0x02020000, 0);
+    if (!check_bytes(0x02020000, (const u8 *)"ABCA", 4)) printf("FAIL: Short codes\n");
+    else printf("PASS: Short codes\n");
+
+    // Chain tree: symbol k < 11 is k ones then a zero, 11 is eleven ones
+    u8 chain[4 + 24] = {0x28, 0x04, 0x00, 0x00, 11};
+    for (int k = 0; k < 11; k++) {
+        chain[4 + 2 * k + 1] = (k == 10) ? 0xC0 : 0x80;
+        chain[4 + 2 * k + 2] = k;
+    }
+    chain[4 + 23] = 11;
+    u32 words[2] = {0, 0};
+    pos = 0;
+    push_bits(words, &pos, 0x7FF, 11);
+    push_bits(words, &pos, 0, 1);
+    push_bits(words, &pos, 0x3FE, 10);
+    push_bits(words, &pos, 0xE, 4);
+    put_bytes(0x02010000, chain, sizeof(chain));
+    bus_write32(0x0201001C, words[0]);
+    bus_write32(0x02010020, words[1]);
+    run_swi(0x13, 0x02010000, 0x02020000, 0);
+    const u8 expect[] = {11, 0, 9, 3};
+    if (!check_bytes(0x02020000, expect, 4)) printf("FAIL: Codes longer than 8 bits\n");
+    else printf("PASS: Codes longer than 8 bits\n");
+}
+
+static void unpack(u32 src_byte, u8 src_width, u8 dst_width, u32 offset) {
+    bus_write8(0x02010000, src_byte);
+    bus_write16(0x02010100, 1);
+    bus_write8(0x02010102, src_width);
+    bus_write8(0x02010103, dst_width);
+    bus_write32(0x02010104, offset);
+    run_swi(0x10, 0x02010000, 0x02020000, 0x02010100);
+}
+
+void test_bit_unpack() {
+    printf("Testing BitUnPack...\n");
+    memory_init();
+
+    unpack(0x81, 1, 4, 0);
+    bool ok = bus_read32(0x02020000) == 0x10000001;
+    unpack(0x81, 1, 4, 2);
+    ok = ok && bus_read32(0x02020000) == 0x30000003;
+    unpack(0x81, 1, 4, 0x80000002);
+    ok = ok && bus_read32(0x02020000) == 0x32222223;
+    if (!ok) printf("FAIL: 1->4 bpp -> %08X\n", bus_read32(0x02020000));
+    else printf("PASS: 1->4 bpp with offset and zero flag\n");
+
+    unpack(0xE4, 2, 8, 0);
+    if (bus_read32(0x02020000) != 0x03020100) printf("FAIL: 2->8 bpp -> %08X\n", bus_read32(0x02020000));
+    else printf("PASS: 2->8 bpp\n");
+
+    unpack(0x81, 1, 8, 0);
+    if (bus_read32(0x02020000) != 0x00000001 || bus_read32(0x02020004) != 0x01000000)
+        printf("FAIL: 1->8 bpp -> %08X %08X\n", bus_read32(0x02020000), bus_read32(0x02020004));
+    else printf("PASS: 1->8 bpp\n");
+}
+
+static ARM7TDMI math_swi(u8 number, u32 r0, u32 r1) {
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.r[0] = r0;
+    cpu.r[1] = r1;
+    bios_handle_swi(&cpu, number);
+    return cpu;
+}
+
+static bool near(u32 value, u32 expect, u32 tolerance) {
+    s32 diff = (s16)(value - expect);
+    return diff >= -(s32)tolerance && diff <= (s32)tolerance;
+}
+
+void test_math() {
+    printf("Testing Math SWIs...\n");
+    memory_init();
+
+    ARM7TDMI c = math_swi(0x06, (u32)-7, 2);
+    bool ok = c.r[0] == (u32)-3 && c.r[1] == (u32)-1 && c.r[3] == 3;
+    c = math_swi(0x07, 2, (u32)-7);
+    ok = ok && c.r[0] == (u32)-3 && c.r[1] == (u32)-1 && c.r[3] == 3;
+    if (!ok) printf("FAIL: Div/DivArm -> %d %d %d\n", c.r[0], c.r[1], c.r[3]);
+    else printf("PASS: Div/DivArm with |quotient| in R3\n");
+
+    c = math_swi(0x06, 5, 0);
+    if (c.r[0] != 1 || c.r[1] != 5 || c.r[3] != 1) printf("FAIL: Div by zero -> %d %d %d\n", c.r[0], c.r[1], c.r[3]);
+    else printf("PASS: Div by zero\n");
+
+    ok = math_swi(0x08, 0xFFFFFFFF, 0).r[0] == 0xFFFF && math_swi(0x08, 144, 0).r[0] == 12 &&
+         math_swi(0x08, 143, 0).r[0] == 11;
+    if (!ok) printf("FAIL: Sqrt\n");
+    else printf("PASS: Sqrt\n");
+
+    ok = math_swi(0x09, 0, 0).r[0] == 0 && near(math_swi(0x09, 0x4000, 0).r[0], 0x2000, 8) &&
+         near(math_swi(0x09, (u32)-0x4000, 0).r[0], (u32)-0x2000, 8);
+    if (!ok) printf("FAIL: ArcTan -> %08X\n", math_swi(0x09, 0x4000, 0).r[0]);
+    else printf("PASS: ArcTan\n");
+
+    ok = near(math_swi(0x0A, 100, 100).r[0], 0x2000, 8) &&
+         math_swi(0x0A, (u32)-1, 0).r[0] == 0x8000 && math_swi(0x0A, 0, (u32)-5).r[0] == 0xC000 &&
+         near(math_swi(0x0A, 100, (u32)-100).r[0], 0xE000, 8) &&
+         near(math_swi(0x0A, (u32)-100, (u32)-1).r[0], 0x8066, 8) &&
+         math_swi(0x0A, 3, 4).r[0] < 0x4000;
+    if (!ok) printf("FAIL: ArcTan2 -> %04X\n", math_swi(0x0A, 100, 100).r[0]);
+    else printf("PASS: ArcTan2 octants\n");
+}
+
+void test_affine_set() {
+    printf("Testing Affine Set...\n");
+    memory_init();
+
+    // Identity and a quarter turn, into OAM (stride 8) and packed (stride 2)
+    const u16 obj_src[] = {0x100, 0x100, 0x0000, 0, 0x200, 0x100, 0x4000, 0};
+    for (int i = 0; i < 8; i++) bus_write16(0x02010000 + i * 2, obj_src[i]);
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.r[0] = 0x02010000;
+    cpu.r[1] = 0x07000006;
+    cpu.r[2] = 2;
+    cpu.r[3] = 8;
+    bios_handle_swi(&cpu, 0x0F);
+    bool ok = bus_read16(0x07000006) == 0x100 && bus_read16(0x0700000E) == 0 &&
+              bus_read16(0x07000016) == 0 && bus_read16(0x0700001E) == 0x100 &&
+              bus_read16(0x07000026) == 0 && bus_read16(0x0700002E) == 0xFE00 &&
+              bus_read16(0x07000036) == 0x100 && bus_read16(0x0700003E) == 0;
+    if (!ok) printf("FAIL: ObjAffineSet into OAM\n");
+    else printf("PASS: ObjAffineSet into OAM\n");
+
+    // Packed matrix (stride 2)
+    cpu.r[0] = 0x02010008;
+    cpu.r[1] = 0x02020000;
+    cpu.r[2] = 1;
+    cpu.r[3] = 2;
+    bios_handle_swi(&cpu, 0x0F);
+    ok = bus_read16(0x02020000) == 0 && bus_read16(0x02020002) == 0xFE00 &&
+         bus_read16(0x02020004) == 0x100 && bus_read16(0x02020006) == 0;
+    if (!ok) printf("FAIL: ObjAffineSet packed\n");
+    else printf("PASS: ObjAffineSet packed\n");
+
+    // Texture center (16, 0) at screen (120, 80), no rotation
+    bus_write32(0x02010000, 0x1000);
+    bus_write32(0x02010004, 0);
+    bus_write16(0x02010008, 120);
+    bus_write16(0x0201000A, 80);
+    bus_write16(0x0201000C, 0x100);
+    bus_write16(0x0201000E, 0x100);
+    bus_write16(0x02010010, 0);
+    cpu.r[0] = 0x02010000;
+    cpu.r[1] = 0x04000020;
+    cpu.r[2] = 1;
+    bios_handle_swi(&cpu, 0x0E);
+    ok = bus_read16(0x04000020) == 0x100 && bus_read16(0x04000022) == 0 &&
+         bus_read16(0x04000026) == 0x100 && bus_read32(0x04000028) == (u32)(0x1000 - 120 * 0x100) &&
+         bus_read32(0x0400002C) == (u32)(-80 * 0x100);
+    if (!ok) printf("FAIL: BgAffineSet -> X %08X Y %08X\n", bus_read32(0x04000028), bus_read32(0x0400002C));
+    else printf("PASS: BgAffineSet into BG2 registers\n");
+}
+
+void test_cpu_set() {
+    printf("Testing CpuSet/CpuFastSet...\n");
+    memory_init();
+
+    for (int i = 0; i < 16; i++) bus_write16(0x02010000 + i * 2, 0x1000 + i);
+    run_swi(0x0B, 0x02010000, 0x02020000, 16);
+    bool ok = true;
+    for (int i = 0; i < 16; i++) ok = ok && bus_read16(0x02020000 + i * 2) == 0x1000 + i;
+    if (!ok) printf("FAIL: CpuSet 16-bit copy\n");
+    else printf("PASS: CpuSet 16-bit copy\n");
+
+    // 32-bit fill of all of VRAM
+    bus_write32(0x02010000, 0x12345678);
+    bus_cycles = 0;
+    run_swi(0x0B, 0x02010000, 0x06000000, 0x05000000 | 0x6000);
+    ok = bus_read32(0x06000000) == 0x12345678 && bus_read32(0x06017FFC) == 0x12345678;
+    if (!ok) printf("FAIL: CpuSet 32-bit fill\n");
+    else printf("PASS: CpuSet 32-bit fill (%d cycles)\n", bus_cycles);
+
+    // Only the top byte set: must not take the byte-memset path
+    bus_write32(0x02010000, 0x80000000);
+    run_swi(0x0B, 0x02010000, 0x02030000, 0x05000000 | 16);
+    ok = bus_read32(0x02030000) == 0x80000000 && bus_read32(0x0203003C) == 0x80000000;
+    bus_write32(0x02010000, 0xFF000000);
+    run_swi(0x0C, 0x02010000, 0x02030100, 0x01000000 | 16);
+    ok = ok && bus_read32(0x02030100) == 0xFF000000 && bus_read32(0x0203013C) == 0xFF000000;
+    if (!ok) printf("FAIL: Fill of 0xXX000000 values\n");
+    else printf("PASS: CpuSet/CpuFastSet fill 0x80000000 / 0xFF000000\n");
+    bus_write32(0x02010000, 0x12345678);
+
+    // Count rounds up to 8 words
+    bus_write32(0x02020020, 0xAAAAAAAA);
+    bus_write32(0x02020024, 0xAAAAAAAA);
+    run_swi(0x0C, 0x02010000, 0x02020000, 0x01000000 | 3);
+    ok = bus_read32(0x0202001C) == 0x12345678 && bus_read32(0x02020020) == 0xAAAAAAAA;
+    if (!ok) printf("FAIL: CpuFastSet rounding\n");
+    else printf("PASS: CpuFastSet rounds to 8 words\n");
+
+    // Ascending copy onto itself repeats the first word
+    bus_write32(0x02010000, 0x11111111);
+    bus_write32(0x02010004, 0x22222222);
+    run_swi(0x0B, 0x02010000, 0x02010004, 0x04000000 | 4);
+    ok = bus_read32(0x02010010) == 0x11111111 && bus_read32(0x02010008) == 0x11111111;
+    if (!ok) printf("FAIL: Overlapping copy\n");
+    else printf("PASS: Overlapping copy ascends\n");
+
+    // Region-crossing fill goes through the bus (VRAM mirror)
+    run_swi(0x0C, 0x02010000, 0x06017FF0, 0x01000000 | 8);
+    ok = bus_read32(0x06017FF0) == 0x11111111 && bus_read32(0x06010000) == 0x11111111 &&
+         bus_read32(0x0601000C) == 0x11111111;
+    if (!ok) printf("FAIL: Region-crossing fill\n");
+    else printf("PASS: Region-crossing fill\n");
+}
+
+void test_intr_wait() {
+    printf("Testing IntrWait/Halt...\n");
+    memory_init();
+
+    // Flag already acknowledged and not discarded: returns at once
+    bus_write16(0x03007FF8, 1);
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.r[0] = 0;
+    cpu.r[1] = 1;
+    bios_handle_swi(&cpu, 0x04);
+    if (cpu.halted || bus_read16(0x03007FF8) != 0) printf("FAIL: IntrWait with flag set\n");
+    else printf("PASS: IntrWait returns and clears a set flag\n");
+
+    // VBlankIntrWait (Thumb SWI 5) discards the old flag and halts on itself
+    bus_write16(0x03007FF8, 1);
+    bus_write16(0x02000000, 0xDF05);
+    cpu_init(&cpu);
+    cpu.cpsr |= FLAG_T | 0x80; // IRQs masked: wake without dispatch
+    cpu.r[REG_PC] = 0x02000000;
+    cpu_step(&cpu);
+    if (!cpu.halted || cpu.r[REG_PC] != 0x02000000 || bus_read16(0x03007FF8) != 0)
+        printf("FAIL: VBlankIntrWait halt -> PC %08X\n", cpu.r[REG_PC]);
+    else printf("PASS: VBlankIntrWait halts on the SWI\n");
+
+    // Halted: skip to the next PPU edge rather than idling
+    int skip = cpu_step(&cpu);
+    if (skip != ppu_cycles_until_event() || skip <= 2) printf("FAIL: Halt skipped %d cycles\n", skip);
+    else printf("PASS: Halt skips %d cycles to the next event\n", skip);
+
+    // VBlank requested but not acknowledged by a handler: wait again
+    bus_write16(0x04000200, 1);
+    io_request_irq(1);
+    cpu_step(&cpu);
+    if (!cpu.halted || cpu.r[REG_PC] != 0x02000000) printf("FAIL: Unacknowledged wake\n");
+    else printf("PASS: Wake without BIOS flag waits again\n");
+
+    // Handler acknowledged VBlank: the retry returns past the SWI
+    bus_write16(0x03007FF8, 1);
+    cpu_step(&cpu);
+    if (cpu.halted || cpu.r[REG_PC] != 0x02000002 || bus_read16(0x03007FF8) != 0)
+        printf("FAIL: VBlankIntrWait return -> PC %08X\n", cpu.r[REG_PC]);
+    else printf("PASS: VBlankIntrWait returns after acknowledgement\n");
+
+    // Halt ends on IE & IF even with IME clear
+    bus_write16(0x04000208, 0);
+    cpu.halted = true;
+    cpu_step(&cpu);
+    if (cpu.halted) printf("FAIL: Halt with IME clear never wakes\n");
+    else printf("PASS: Halt wakes with IME clear\n");
+
+    // Stop ignores VBlank, wakes on keypad
+    cpu.halted = cpu.stopped = true;
+    cpu_step(&cpu);
+    bool still = cpu.halted;
+    bus_write16(0x04000200, 0x1001);
+    io_request_irq(0x1000);
+    cpu_step(&cpu);
+    if (!still || cpu.halted) printf("FAIL: Stop wake-up sources\n");
+    else printf("PASS: Stop wakes only on keypad\n");
+}
+
+static void test_irq_dispatch() {
+    printf("Testing IRQ dispatch through the BIOS stub...\n");
+    memory_init();
+    io_init();
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    bios_init(&cpu);
+
+    // Handler acknowledges IF through R0 = 0x04000000 set up by the stub
+    bus_write32(0x03000000, 0xE3A01001); // mov r1, #1
+    bus_write32(0x03000004, 0xE2802C02); // add r2, r0, #0x200
+    bus_write32(0x03000008, 0xE1C210B2); // strh r1, [r2, #2]
+    bus_write32(0x0300000C, 0xE12FFF1E); // bx lr
+    bus_write32(0x03007FFC, 0x03000000);
+    bus_write32(0x02000000, 0xE1A00000); // nop
+    bus_write32(0x02000004, 0xE1A00000);
+
+    bus_write16(0x04000200, 1);
+    bus_write16(0x04000208, 1);
+    if (io_irq_pending != 0) printf("FAIL: Pending without IF\n");
+    io_request_irq(1);
+    if (io_irq_pending != 1 || !io_irq_master) printf("FAIL: Cached pending %04X\n", io_irq_pending);
+    else printf("PASS: IF raise updates the cached pending mask\n");
+
+    cpu.r[REG_PC] = 0x02000000;
+    cpu.r[0] = 0x1234;
+    u32 sp = cpu.r[REG_SP];
+    bool saw_stub = false, saw_handler = false;
+    for (int i = 0; i < 32; i++) {
+        cpu_step(&cpu);
+        if (cpu.r[REG_PC] < 0x4000) saw_stub = true;
+        if (cpu.r[REG_PC] == 0x03000000) saw_handler = true;
+        if (saw_handler && (cpu.r[REG_PC] >> 24) == 0x02) break;
+    }
+    if (!saw_stub || !saw_handler) printf("FAIL: IRQ path stub=%d handler=%d\n", saw_stub, saw_handler);
+    else if ((cpu.cpsr & 0x1F) != 0x1F || (cpu.cpsr & 0x80) || cpu.r[0] != 0x1234 || cpu.r[REG_SP] != sp ||
+             cpu.r[REG_PC] > 0x02000004)
+        printf("FAIL: IRQ return CPSR=%08X R0=%08X SP=%08X PC=%08X\n", cpu.cpsr, cpu.r[0], cpu.r[REG_SP],
+               cpu.r[REG_PC]);
+    else printf("PASS: IRQ runs the user handler and returns to the interrupted code\n");
+
+    if (io_irq_pending != 0) printf("FAIL: Acknowledge left pending %04X\n", io_irq_pending);
+    else printf("PASS: IF acknowledge clears the cached pending mask\n");
+}
+
+static void test_lle_swi() {
+    printf("Testing LLE SWI entry...\n");
+    memory_init();
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+
+    // Minimal image: the SWI handler returns at once (MOVS PC, LR)
+    const char *path = "test_bios.tmp";
+    static u8 image[BIOS_SIZE];
+    u32 movs_pc_lr = 0xE1B0F00E;
+    memcpy(&image[0x08], &movs_pc_lr, 4);
+    FILE *f = fopen(path, "wb");
+    fwrite(image, 1, sizeof(image), f);
+    fclose(f);
+    bool loaded = bios_load_file(path);
+    remove(path);
+    if (!loaded || !bios_lle || bus_read32(0x08) != movs_pc_lr) {
+        printf("FAIL: BIOS image not loaded\n");
+        return;
+    }
+    printf("PASS: BIOS image loaded\n");
+
+    // Not accelerated: ARM SWI 0x08 enters the vector in Supervisor mode
+    bios_set_accelerators(BIOS_ACCEL_DEFAULT);
+    bus_write32(0x02000000, 0xEF080000); // swi 0x08
+    cpu.r[REG_PC] = 0x02000000;
+    cpu.r[0] = 16;
+    cpu_step(&cpu);
+    bool entered = cpu.r[REG_PC] == 0x08 && (cpu.cpsr & 0x1F) == 0x13 && cpu.r[REG_LR] == 0x02000004;
+    cpu_step(&cpu);
+    if (!entered || cpu.r[REG_PC] != 0x02000004 || (cpu.cpsr & 0x1F) != 0x1F || cpu.r[0] != 16)
+        printf("FAIL: LLE SWI round trip PC=%08X CPSR=%08X R0=%08X\n", cpu.r[REG_PC], cpu.cpsr, cpu.r[0]);
+    else printf("PASS: LLE SWI runs the BIOS handler\n");
+
+    // Accelerated: Thumb Div returns past the SWI with the HLE result
+    bus_write16(0x02000100, 0xDF06); // swi 0x06
+    cpu.cpsr |= FLAG_T;
+    cpu.r[REG_PC] = 0x02000100;
+    cpu.r[0] = 100;
+    cpu.r[1] = 7;
+    cpu_step(&cpu);
+    if (cpu.r[REG_PC] != 0x02000102 || (cpu.cpsr & 0x1F) != 0x1F || !(cpu.cpsr & FLAG_T) || cpu.r[0] != 14 ||
+        cpu.r[1] != 2)
+        printf("FAIL: Accelerated Div PC=%08X CPSR=%08X R0=%d\n", cpu.r[REG_PC], cpu.cpsr, cpu.r[0]);
+    else printf("PASS: Accelerated SWI short-cuts the BIOS handler\n");
+
+    // Accelerators off: the same call goes through the vector
+    bios_set_accelerators(0);
+    cpu.r[REG_PC] = 0x02000100;
+    cpu_step(&cpu);
+    if (cpu.r[REG_PC] != 0x08 || cpu.r[REG_LR] != 0x02000102) printf("FAIL: Disabled accelerator\n");
+    else printf("PASS: Disabled accelerator enters the vector\n");
+
+    // RegisterRamReset can be accelerated; Halt never is
+    bios_set_accelerators((1ull << 0x01) | (1ull << 0x02));
+    bus_write16(0x02000104, 0xDF01); // swi 0x01
+    bus_write16(0x02000106, 0xDF02); // swi 0x02
+    cpu_set_cpsr(&cpu, 0x3F);
+    cpu.r[REG_PC] = 0x02000104;
+    cpu.r[0] = 0; // Clear nothing
+    cpu_step(&cpu);
+    bool reset_fast = cpu.r[REG_PC] == 0x02000106;
+    cpu_step(&cpu);
+    if (!reset_fast || cpu.r[REG_PC] != 0x08 || cpu.r[REG_LR] != 0x02000108)
+        printf("FAIL: Accelerator mask PC=%08X LR=%08X\n", cpu.r[REG_PC], cpu.r[REG_LR]);
+    else printf("PASS: RegisterRamReset accelerated, Halt kept in the BIOS\n");
+
+    bios_init(&cpu); // Back to HLE
+}
+
+int main() {
+    printf("Running BIOS Unit Tests...\n");
+    test_lz77_wram();
+    test_lz77_vram();
+    test_lz77_bus_fallback();
+    test_rl_uncomp();
+    test_diff_unfilter();
+    test_huff_uncomp();
+    test_bit_unpack();
+    test_math();
+    test_affine_set();
+    test_cpu_set();
+    test_intr_wait();
+    test_irq_dispatch();
+    test_lle_swi();
+    printf("Tests Complete.\n");
+    return 0;
+}
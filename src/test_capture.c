@@ -0,0 +1,86 @@
+#include "../include/capture.h"
+#include "../include/ppu.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PIXELS (GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT)
+
+static u32 frame[PIXELS];
+static u8 y_simd[PIXELS], u_simd[PIXELS / 4], v_simd[PIXELS / 4];
+static u8 y_ref[PIXELS], u_ref[PIXELS / 4], v_ref[PIXELS / 4];
+
+void test_yuv_matches_scalar() {
+    printf("Testing RGB->YUV420 Kernels...\n");
+    u32 seed = 12345;
+    for (int i = 0; i < PIXELS; i++) {
+        seed = seed * 1103515245 + 12345;
+        frame[i] = 0xFF000000 | (seed >> 8);
+    }
+    capture_rgb_to_yuv420(frame, y_simd, u_simd, v_simd);
+    capture_rgb_to_yuv420_scalar(frame, y_ref, u_ref, v_ref);
+
+    if (memcmp(y_simd, y_ref, sizeof(y_ref)) || memcmp(u_simd, u_ref, sizeof(u_ref)) ||
+        memcmp(v_simd, v_ref, sizeof(v_ref))) {
+        printf("FAIL: Vector YUV conversion differs from scalar reference\n");
+    } else {
+        printf("PASS: Vector YUV conversion matches scalar reference\n");
+    }
+
+    // White -> Y=235, Black -> Y=16, both neutral chroma
+    for (int i = 0; i < PIXELS; i++) frame[i] = (i < PIXELS / 2) ? 0xFFFFFFFF : 0xFF000000;
+    capture_rgb_to_yuv420(frame, y_simd, u_simd, v_simd);
+    if (y_simd[0] != 235 || y_simd[PIXELS - 1] != 16 || u_simd[0] != 128 || v_simd[0] != 128) {
+        printf("FAIL: White/Black -> Y=%d/%d U=%d V=%d\n", y_simd[0], y_simd[PIXELS - 1],
+               u_simd[0], v_simd[0]);
+    } else {
+        printf("PASS: White/Black limited range levels\n");
+    }
+}
+
+void test_rgba_order() {
+    printf("Testing ARGB->RGBA...\n");
+    u32 px = 0xFF112233;
+    u8 out[4];
+    capture_argb_to_rgba(&px, out, 1);
+    if (out[0] != 0x11 || out[1] != 0x22 || out[2] != 0x33 || out[3] != 0xFF) {
+        printf("FAIL: RGBA bytes %02X %02X %02X %02X\n", out[0], out[1], out[2], out[3]);
+    } else {
+        printf("PASS: RGBA byte order\n");
+    }
+}
+
+void test_y4m_stream() {
+    printf("Testing Y4M Stream...\n");
+    const char *path = "test_capture.tmp";
+    if (!capture_open(path, CAPTURE_Y4M)) {
+        printf("FAIL: capture_open\n");
+        return;
+    }
+    for (int i = 0; i < 5; i++) capture_frame(frame);
+    capture_close();
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("FAIL: Capture file missing\n");
+        return;
+    }
+    char header[128] = {0};
+    fgets(header, sizeof(header), f);
+    long header_len = ftell(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    remove(path);
+
+    long expected = header_len + 5 * (6 + PIXELS + PIXELS / 2);
+    if (strncmp(header, "YUV4MPEG2 W240 H160", 19) != 0) printf("FAIL: Y4M header '%s'\n", header);
+    else if (size != expected) printf("FAIL: Y4M size %ld (expected %ld)\n", size, expected);
+    else printf("PASS: Y4M stream with 5 frames\n");
+}
+
+int main() {
+    test_yuv_matches_scalar();
+    test_rgba_order();
+    test_y4m_stream();
+    return 0;
+}
@@ -119,6 +119,246 @@ void test_thumb_basic() {
     else printf("PASS: [Thumb] LSL R1, R0, #2\n");
 }
 
+void test_lazy_flags() {
+    printf("Testing Lazy Flags...\n");
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.r[REG_PC] = 0x02000000;
+
+    // ADDS R2, R0, R1 with 0x7FFFFFFF + 1: N and V set, Z and C clear
+    // E0902001
+    bus_write32(0x02000000, 0xE0902001);
+    // ANDS R3, R2, R1: Z set, C from shifter (0), V must survive
+    // E0123001
+    bus_write32(0x02000004, 0xE0123001);
+    // ADDEQ R4, R4, #1 (taken: Z is set)
+    // 02844001
+    bus_write32(0x02000008, 0x02844001);
+    cpu.r[0] = 0x7FFFFFFF;
+    cpu.r[1] = 1;
+
+    cpu_step(&cpu);
+    u32 f = cpu_get_cpsr(&cpu) & 0xF0000000;
+    if (f != (FLAG_N | FLAG_V)) printf("FAIL: ADDS overflow flags %08X\n", f);
+    else printf("PASS: ADDS sets N/V from pending operands\n");
+
+    cpu_step(&cpu);
+    cpu_step(&cpu);
+    f = cpu_get_cpsr(&cpu) & 0xF0000000;
+    if (f != (FLAG_Z | FLAG_V)) printf("FAIL: ANDS flags %08X\n", f);
+    else if (cpu.r[4] != 1) printf("FAIL: ADDEQ not taken\n");
+    else printf("PASS: Logical op keeps V, condition sees pending Z\n");
+
+    // Thumb: CMP R0, #5 with R0 = 3 -> borrow (C clear), N set
+    cpu_init(&cpu);
+    cpu.r[REG_PC] = 0x02000000;
+    cpu.cpsr |= FLAG_T;
+    cpu.r[0] = 3;
+    bus_write16(0x02000000, 0x2805);
+    cpu_step(&cpu);
+    f = cpu_get_cpsr(&cpu) & 0xF0000000;
+    if (f != FLAG_N) printf("FAIL: [Thumb] CMP flags %08X\n", f);
+    else printf("PASS: [Thumb] CMP borrow\n");
+}
+
+// Run `count` ARM opcodes from `pc`
+static void run_arm(ARM7TDMI *cpu, u32 pc, const u32 *ops, int count) {
+    for (int i = 0; i < count; i++) bus_write32(pc + i * 4, ops[i]);
+    cpu->r[REG_PC] = pc;
+    for (int i = 0; i < count; i++) cpu_step(cpu);
+}
+
+void test_arm_extended() {
+    printf("Testing ARM Extended Instructions...\n");
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+
+    // BL +0x10 -> LR = next instruction
+    bus_write32(0x02000100, 0xEB000004);
+    cpu.r[REG_PC] = 0x02000100;
+    cpu_step(&cpu);
+    if (cpu.r[REG_PC] != 0x02000118 || cpu.r[REG_LR] != 0x02000104)
+        printf("FAIL: BL -> PC %08X LR %08X\n", cpu.r[REG_PC], cpu.r[REG_LR]);
+    else printf("PASS: BL\n");
+
+    // STMDB SP!, {R0-R3}; LDMIA SP!, {R4-R7} (IWRAM fast path)
+    cpu.r[REG_SP] = 0x03007F00;
+    for (int i = 0; i < 4; i++) cpu.r[i] = i + 1;
+    const u32 push_pop[] = {0xE92D000F, 0xE8BD00F0};
+    run_arm(&cpu, 0x02000200, push_pop, 1);
+    bool ok = cpu.r[REG_SP] == 0x03007EF0 && bus_read32(0x03007EF0) == 1 &&
+              bus_read32(0x03007EFC) == 4;
+    run_arm(&cpu, 0x02000204, push_pop + 1, 1);
+    ok = ok && cpu.r[REG_SP] == 0x03007F00 && cpu.r[4] == 1 && cpu.r[7] == 4;
+    if (!ok) printf("FAIL: STMDB/LDMIA -> SP %08X R4 %X R7 %X\n", cpu.r[REG_SP], cpu.r[4], cpu.r[7]);
+    else printf("PASS: STMDB/LDMIA\n");
+
+    // STMIA R8, {R0,R1} into the VRAM mirror (per-word slow path)
+    cpu.r[8] = 0x06018000;
+    const u32 stm_mirror[] = {0xE8880003};
+    run_arm(&cpu, 0x02000208, stm_mirror, 1);
+    if (bus_read32(0x06010000) != 1 || bus_read32(0x06010004) != 2)
+        printf("FAIL: STMIA to VRAM mirror -> %X %X\n", bus_read32(0x06010000), bus_read32(0x06010004));
+    else printf("PASS: STMIA through the bus\n");
+
+    // MUL R2, R0, R1; UMULL R4, R5, R0, R1; SMULL R6, R7, R3, R1
+    cpu.r[0] = 0xFFFFFFFF;
+    cpu.r[1] = 2;
+    cpu.r[3] = 0xFFFFFFFF;
+    const u32 muls[] = {0xE0020190, 0xE0854190, 0xE0C76193};
+    run_arm(&cpu, 0x02000300, muls, 3);
+    if (cpu.r[2] != 0xFFFFFFFE || cpu.r[4] != 0xFFFFFFFE || cpu.r[5] != 1 ||
+        cpu.r[6] != 0xFFFFFFFE || cpu.r[7] != 0xFFFFFFFF)
+        printf("FAIL: MUL/UMULL/SMULL -> %08X %08X:%08X %08X:%08X\n", cpu.r[2], cpu.r[5],
+               cpu.r[4], cpu.r[7], cpu.r[6]);
+    else printf("PASS: MUL/UMULL/SMULL\n");
+
+    // SWP R2, R1, [R0]
+    cpu.r[0] = 0x02003000;
+    cpu.r[1] = 0x22222222;
+    bus_write32(0x02003000, 0x11111111);
+    const u32 swp[] = {0xE1002091};
+    run_arm(&cpu, 0x02000400, swp, 1);
+    if (cpu.r[2] != 0x11111111 || bus_read32(0x02003000) != 0x22222222)
+        printf("FAIL: SWP -> R2 %08X mem %08X\n", cpu.r[2], bus_read32(0x02003000));
+    else printf("PASS: SWP\n");
+
+    // LDRH R1,[R0,#2]; LDRSB R2,[R0,#1]; LDRSH R3,[R0,#2]; STRH R1,[R0,#4]
+    bus_write32(0x02003000, 0x8081FF80);
+    const u32 halves[] = {0xE1D010B2, 0xE1D020D1, 0xE1D030F2, 0xE1C010B4};
+    run_arm(&cpu, 0x02000500, halves, 4);
+    if (cpu.r[1] != 0x8081 || cpu.r[2] != 0xFFFFFFFF || cpu.r[3] != 0xFFFF8081 ||
+        bus_read16(0x02003004) != 0x8081)
+        printf("FAIL: LDRH/LDRSB/LDRSH/STRH -> %X %X %X\n", cpu.r[1], cpu.r[2], cpu.r[3]);
+    else printf("PASS: LDRH/LDRSB/LDRSH/STRH\n");
+
+    // MSR CPSR_c, #0xD2 banks SP; MRS R0, CPSR; MSR CPSR_c, #0x1F restores it
+    cpu.r[REG_SP] = 0x03007F00;
+    const u32 to_irq[] = {0xE321F0D2, 0xE10F0000};
+    run_arm(&cpu, 0x02000600, to_irq, 2);
+    u32 irq_sp = cpu.r[REG_SP];
+    cpu.r[REG_SP] = 0x03007FA0;
+    const u32 to_sys[] = {0xE321F01F};
+    run_arm(&cpu, 0x02000608, to_sys, 1);
+    if ((cpu.r[0] & 0xFF) != 0xD2 || irq_sp == 0x03007F00 || cpu.r[REG_SP] != 0x03007F00)
+        printf("FAIL: MRS/MSR -> CPSR %08X SP %08X\n", cpu.r[0], cpu.r[REG_SP]);
+    else printf("PASS: MRS/MSR with banked SP\n");
+
+    // MOVS PC, LR from IRQ mode returns to Thumb System mode
+    run_arm(&cpu, 0x02000600, to_irq, 1);
+    cpu.spsr = 0x6000003F;
+    cpu.r[REG_LR] = 0x02000700;
+    const u32 movs[] = {0xE1B0F00E};
+    run_arm(&cpu, 0x02000610, movs, 1);
+    if (cpu_get_cpsr(&cpu) != 0x6000003F || cpu.r[REG_PC] != 0x02000700 ||
+        cpu.r[REG_SP] != 0x03007F00)
+        printf("FAIL: MOVS PC, LR -> CPSR %08X PC %08X\n", cpu_get_cpsr(&cpu), cpu.r[REG_PC]);
+    else printf("PASS: MOVS PC, LR restores CPSR\n");
+}
+
+void test_thumb_extended() {
+    printf("Testing Thumb Extended Instructions...\n");
+    ARM7TDMI cpu;
+    cpu_init(&cpu);
+    cpu.cpsr |= FLAG_T;
+
+    // BL +4 (two halves)
+    bus_write16(0x02000800, 0xF000);
+    bus_write16(0x02000802, 0xF802);
+    cpu.r[REG_PC] = 0x02000800;
+    cpu_step(&cpu);
+    cpu_step(&cpu);
+    if (cpu.r[REG_PC] != 0x02000808 || cpu.r[REG_LR] != 0x02000805)
+        printf("FAIL: [Thumb] BL -> PC %08X LR %08X\n", cpu.r[REG_PC], cpu.r[REG_LR]);
+    else printf("PASS: [Thumb] BL\n");
+
+    // PUSH {R0,R1,LR}; POP {R2,R3,PC}
+    cpu.r[REG_SP] = 0x03007F00;
+    cpu.r[0] = 0x11;
+    cpu.r[1] = 0x22;
+    cpu.r[REG_LR] = 0x02000901;
+    bus_write16(0x02000808, 0xB503);
+    bus_write16(0x0200080A, 0xBD0C);
+    cpu_step(&cpu);
+    cpu_step(&cpu);
+    if (cpu.r[2] != 0x11 || cpu.r[3] != 0x22 || cpu.r[REG_PC] != 0x02000900 ||
+        cpu.r[REG_SP] != 0x03007F00 || !(cpu.cpsr & FLAG_T))
+        printf("FAIL: [Thumb] PUSH/POP -> R2 %X R3 %X PC %08X\n", cpu.r[2], cpu.r[3], cpu.r[REG_PC]);
+    else printf("PASS: [Thumb] PUSH/POP\n");
+
+    // STMIA R0!, {R1,R2}; LDMIA R3!, {R4,R5}; LDSB R6, [R3, R1]
+    cpu.r[0] = 0x02003100;
+    cpu.r[1] = 0x80;
+    cpu.r[2] = 0x12345678;
+    cpu.r[3] = 0x02003100;
+    bus_write16(0x02000900, 0xC006);
+    bus_write16(0x02000902, 0xCB30);
+    bus_write16(0x02000904, 0x565E);
+    cpu_step(&cpu);
+    cpu_step(&cpu);
+    u32 r3 = cpu.r[3];
+    cpu.r[1] = 0;
+    cpu.r[3] = 0x02003100;
+    cpu_step(&cpu);
+    if (cpu.r[0] != 0x02003108 || r3 != 0x02003108 || cpu.r[4] != 0x80 ||
+        cpu.r[5] != 0x12345678 || cpu.r[6] != 0xFFFFFF80)
+        printf("FAIL: [Thumb] STMIA/LDMIA/LDSB -> R4 %X R5 %X R6 %X\n", cpu.r[4], cpu.r[5], cpu.r[6]);
+    else printf("PASS: [Thumb] STMIA/LDMIA/LDSB\n");
+}
+
+// Reference: the original switch-based condition check
+static bool reference_condition(u32 cond, u32 cpsr) {
+  switch (cond) {
+  case 0x0:
+    return (cpsr & FLAG_Z); // EQ
+  case 0x1:
+    return !(cpsr & FLAG_Z); // NE
+  case 0x2:
+    return (cpsr & FLAG_C); // CS / HS
+  case 0x3:
+    return !(cpsr & FLAG_C); // CC / LO
+  case 0x4:
+    return (cpsr & FLAG_N); // MI
+  case 0x5:
+    return !(cpsr & FLAG_N); // PL
+  case 0x6:
+    return (cpsr & FLAG_V); // VS
+  case 0x7:
+    return !(cpsr & FLAG_V); // VC
+  case 0x8:
+    return (cpsr & FLAG_C) && !(cpsr & FLAG_Z); // HI
+  case 0x9:
+    return !(cpsr & FLAG_C) || (cpsr & FLAG_Z); // LS
+  case 0xA:
+    return (!!(cpsr & FLAG_N) == !!(cpsr & FLAG_V)); // GE
+  case 0xB:
+    return (!!(cpsr & FLAG_N) != !!(cpsr & FLAG_V)); // LT
+  case 0xC:
+    return !(cpsr & FLAG_Z) && (!!(cpsr & FLAG_N) == !!(cpsr & FLAG_V)); // GT
+  case 0xD:
+    return (cpsr & FLAG_Z) || (!!(cpsr & FLAG_N) != !!(cpsr & FLAG_V)); // LE
+  case 0xE:
+    return true; // AL
+  default:
+    return true; // Undefined
+  }
+}
+
+void test_condition_table() {
+    printf("Testing Condition Table...\n");
+    int mismatches = 0;
+    for (u32 nzcv = 0; nzcv < 16; nzcv++) {
+        for (u32 cond = 0; cond < 16; cond++) {
+            u32 cpsr = (nzcv << 28) | 0x1F;
+            if (cpu_check_condition(cond, cpsr) != reference_condition(cond, cpsr)) {
+                printf("FAIL: NZCV=%X cond=%X\n", nzcv, cond);
+                mismatches++;
+            }
+        }
+    }
+    if (!mismatches) printf("PASS: All 256 NZCV/cond combinations match\n");
+}
+
 int main() {
     printf("Running CPU Unit Tests...\n");
     memory_init(); 
@@ -126,6 +366,10 @@ int main() {
     test_arm_basic_alu();
     test_arm_memory();
     test_thumb_basic();
+    test_lazy_flags();
+    test_condition_table();
+    test_arm_extended();
+    test_thumb_extended();
     
     printf("Tests Complete.\n");
     return 0;
@@ -0,0 +1,84 @@
+#include "../include/frame_hash.h"
+#include <stdio.h>
+#include <string.h>
+
+// Reference values from XXH3_64bits() (xxHash 0.8) over the pattern below
+static const struct {
+    size_t len;
+    u64 hash;
+} xxh3_vectors[] = {
+    {0, 0x2d06800538d394c2ULL},      {1, 0xc44bdff4074eecdbULL},
+    {3, 0xe14090f554a5ea90ULL},      {4, 0x2e8d078a566e9749ULL},
+    {8, 0xcd1c7f88482fcaefULL},      {9, 0xbfe43def699fa9e3ULL},
+    {16, 0x81e9eb8634460bb9ULL},     {17, 0x9998430fd0a655beULL},
+    {100, 0x4ff5f6c0d102cd55ULL},    {128, 0x75eca5c5d5594884ULL},
+    {129, 0xa05da42e7a4e4667ULL},    {200, 0xe07bfbc15015bf69ULL},
+    {240, 0x5eb2467c8c9e3969ULL},    {241, 0x2d431e984c441f15ULL},
+    {1024, 0xe99def1145f12936ULL},   {1025, 0x83cba9b371e4e7f4ULL},
+    {153600, 0xb34ac11bf47ac70eULL}, {200000, 0x5213ec9a78cfef85ULL},
+};
+
+static u8 pattern[200000];
+
+void test_xxh3_vectors() {
+    printf("Testing XXH3-64 Vectors...\n");
+    for (int i = 0; i < (int)sizeof(pattern); i++) {
+        pattern[i] = (u8)((i * 2654435761u) >> 24);
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(xxh3_vectors) / sizeof(xxh3_vectors[0]); i++) {
+        u64 got = frame_hash_xxh3(pattern, xxh3_vectors[i].len);
+        if (got != xxh3_vectors[i].hash) {
+            printf("FAIL: XXH3 len=%zu -> %016llx (expected %016llx)\n", xxh3_vectors[i].len,
+                   (unsigned long long)got, (unsigned long long)xxh3_vectors[i].hash);
+            failures++;
+        }
+    }
+    if (failures == 0) printf("PASS: XXH3 matches reference for all lengths\n");
+}
+
+void test_golden_roundtrip() {
+    printf("Testing Golden File Roundtrip...\n");
+    GoldenSet set;
+    golden_init(&set);
+
+    // Out of order inserts and a replacement
+    golden_set(&set, 120, 0x1111111111111111ULL);
+    golden_set(&set, 60, 0x2222222222222222ULL);
+    golden_set(&set, 180, 0x3333333333333333ULL);
+    golden_set(&set, 120, 0xAAAAAAAAAAAAAAAAULL);
+
+    const char *path = "test_golden.tmp";
+    if (!golden_save(&set, path)) {
+        printf("FAIL: Could not save golden file\n");
+        golden_free(&set);
+        return;
+    }
+
+    GoldenSet loaded;
+    golden_init(&loaded);
+    if (!golden_load(&loaded, path)) {
+        printf("FAIL: Could not load golden file\n");
+    } else {
+        u64 hash = 0;
+        if (loaded.count != 3) printf("FAIL: Expected 3 entries, got %d\n", loaded.count);
+        else printf("PASS: Golden entry count\n");
+
+        if (!golden_lookup(&loaded, 120, &hash) || hash != 0xAAAAAAAAAAAAAAAAULL)
+            printf("FAIL: Frame 120 -> %016llx\n", (unsigned long long)hash);
+        else printf("PASS: Golden replace + lookup\n");
+
+        if (golden_lookup(&loaded, 61, &hash)) printf("FAIL: Frame 61 should be missing\n");
+        else printf("PASS: Golden missing frame\n");
+    }
+    remove(path);
+    golden_free(&loaded);
+    golden_free(&set);
+}
+
+int main() {
+    test_xxh3_vectors();
+    test_golden_roundtrip();
+    return 0;
+}
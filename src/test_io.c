@@ -0,0 +1,64 @@
+#include "../include/dma.h"
+#include "../include/io.h"
+#include "../include/memory.h"
+#include <stdio.h>
+
+void test_if_acknowledge() {
+    printf("Testing IF Acknowledge...\n");
+    memory_init();
+    *(u16 *)&memory_get_io()[0x202] = 0x0015; // VBlank, VCount, Timer 1
+
+    bus_write16(0x04000202, 0x0001);
+    if (bus_read16(0x04000202) != 0x0014) printf("FAIL: 16-bit ack -> %04X\n", bus_read16(0x04000202));
+    else printf("PASS: 16-bit write clears only written bits\n");
+
+    // Writing the upper byte must not touch the lower one
+    bus_write8(0x04000203, 0xFF);
+    bus_write8(0x04000202, 0x04);
+    if (bus_read16(0x04000202) != 0x0010) printf("FAIL: 8-bit ack -> %04X\n", bus_read16(0x04000202));
+    else printf("PASS: 8-bit ack per byte lane\n");
+
+    // 32-bit write to IE/IF sets IE and acknowledges IF
+    bus_write32(0x04000200, 0x00100009);
+    if (bus_read16(0x04000200) != 0x0009 || bus_read16(0x04000202) != 0) {
+        printf("FAIL: 32-bit IE/IF write\n");
+    } else {
+        printf("PASS: 32-bit IE/IF write\n");
+    }
+}
+
+void test_read_only() {
+    printf("Testing Read-only Registers...\n");
+    memory_init();
+    bus_write16(0x04000130, 0x0000);
+    bus_write16(0x04000006, 0x0050);
+    *(u16 *)&memory_get_io()[4] = 0x0003; // VBlank + HBlank status
+    bus_write16(0x04000004, 0x0018);
+    if (bus_read16(0x04000130) != 0x03FF) printf("FAIL: KEYINPUT writable\n");
+    else if (bus_read16(0x04000006) != 0) printf("FAIL: VCOUNT writable\n");
+    else if (bus_read16(0x04000004) != 0x001B) printf("FAIL: DISPSTAT -> %04X\n", bus_read16(0x04000004));
+    else printf("PASS: Write masks\n");
+}
+
+void test_byte_side_effects() {
+    printf("Testing 8-bit Side Effects...\n");
+    memory_init();
+    bus_write32(0x02000000, 0xCAFEBABE);
+    bus_write32(0x040000D4, 0x02000000);
+    bus_write32(0x040000D8, 0x03000000);
+    bus_write16(0x040000DC, 1);
+    bus_write8(0x040000DF, 0x84); // Enable, 32-bit via the upper byte only
+    if (bus_read32(0x03000000) != 0xCAFEBABE) printf("FAIL: DMA not started by byte write\n");
+    else printf("PASS: DMA enable through 8-bit write\n");
+
+    bus_write8(0x04000301, 0x00);
+    if (io_take_halt_request() != 1) printf("FAIL: HALTCNT write not seen\n");
+    else printf("PASS: HALTCNT requests Halt\n");
+}
+
+int main() {
+    test_if_acknowledge();
+    test_read_only();
+    test_byte_side_effects();
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "../include/png.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define W 240
+#define H 160
+
+static u32 image[W * H];
+
+static u32 be32(const u8 *p) { return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+void test_checksums() {
+    printf("Testing PNG Checksums...\n");
+    u32 crc = png_crc32(0, (const u8 *)"123456789", 9);
+    if (crc != 0xCBF43926) printf("FAIL: CRC32 -> %08X\n", crc);
+    else printf("PASS: CRC32 check value\n");
+
+    u32 adler = png_adler32(1, (const u8 *)"Wikipedia", 9);
+    if (adler != 0x11E60398) printf("FAIL: Adler32 -> %08X\n", adler);
+    else printf("PASS: Adler32 check value\n");
+}
+
+// Decode a stored-block PNG back to ARGB and compare
+void test_stored_roundtrip() {
+    printf("Testing PNG Stored Roundtrip...\n");
+    for (int i = 0; i < W * H; i++) image[i] = 0xFF000000 | (i * 2654435761u >> 8);
+
+    u8 *png = NULL;
+    size_t len = png_encode(image, W, H, PNG_LEVEL_STORED, &png);
+    if (!len || memcmp(png, "\x89PNG\r\n\x1a\n", 8) != 0) {
+        printf("FAIL: PNG signature\n");
+        free(png);
+        return;
+    }
+    if (be32(png + 16) != W || be32(png + 20) != H || be32(png + 29) != png_crc32(0, png + 12, 17)) {
+        printf("FAIL: IHDR\n");
+        free(png);
+        return;
+    }
+    printf("PASS: Signature and IHDR\n");
+
+    // IDAT follows IHDR; skip the 2-byte zlib header
+    u32 idat_len = be32(png + 33);
+    const u8 *z = png + 41 + 2;
+    const u8 *z_end = png + 41 + idat_len - 4;
+    static u8 raw[H * (W * 3 + 1)];
+    size_t raw_len = 0;
+    bool final = false;
+    while (!final && z < z_end) {
+        final = z[0] & 1;
+        u32 n = z[1] | (z[2] << 8);
+        memcpy(raw + raw_len, z + 5, n);
+        raw_len += n;
+        z += 5 + n;
+    }
+
+    int mismatches = 0;
+    static u8 prev[W * 3], cur[W * 3];
+    memset(prev, 0, sizeof(prev));
+    for (int y = 0; y < H; y++) {
+        const u8 *row = raw + y * (W * 3 + 1);
+        int f = row[0];
+        for (int i = 0; i < W * 3; i++) {
+            int a = i >= 3 ? cur[i - 3] : 0, b = prev[i], c = i >= 3 ? prev[i - 3] : 0;
+            int pred = 0;
+            if (f == 1) pred = a;
+            else if (f == 2) pred = b;
+            else if (f == 3) pred = (a + b) >> 1;
+            else if (f == 4) {
+                int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                pred = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+            }
+            cur[i] = (u8)(row[1 + i] + pred);
+        }
+        for (int x = 0; x < W; x++) {
+            u32 px = 0xFF000000 | (cur[x * 3] << 16) | (cur[x * 3 + 1] << 8) | cur[x * 3 + 2];
+            if (px != image[y * W + x]) mismatches++;
+        }
+        memcpy(prev, cur, sizeof(cur));
+    }
+    if (raw_len != sizeof(raw) || mismatches) {
+        printf("FAIL: Roundtrip %zu bytes, %d pixel mismatches\n", raw_len, mismatches);
+    } else {
+        printf("PASS: Stored roundtrip\n");
+    }
+    if (be32(z_end) != png_adler32(1, raw, raw_len)) printf("FAIL: zlib Adler32\n");
+    else printf("PASS: zlib Adler32\n");
+    free(png);
+}
+
+void test_fast_compresses() {
+    printf("Testing PNG Fast Deflate...\n");
+    // Tiled screen: a few colors repeating like a typical Mode 0 frame
+    for (int i = 0; i < W * H; i++) image[i] = ((i / 8) & 1) ? 0xFF3050F8 : 0xFF000000;
+    u8 *stored = NULL, *fast = NULL;
+    size_t stored_len = png_encode(image, W, H, PNG_LEVEL_STORED, &stored);
+    size_t fast_len = png_encode(image, W, H, PNG_LEVEL_FAST, &fast);
+    if (!fast_len || fast_len * 20 > stored_len) {
+        printf("FAIL: Fast deflate %zu bytes vs stored %zu\n", fast_len, stored_len);
+    } else {
+        printf("PASS: Fast deflate %zu bytes (stored %zu)\n", fast_len, stored_len);
+    }
+    free(stored);
+    free(fast);
+}
+
+void test_raw_deflate() {
+    printf("Testing Raw Deflate Roundtrip...\n");
+    // Noise, a long run (overlapping matches) and repeated phrases
+    static u8 data[100000], back[100000];
+    u32 seed = 1;
+    for (int i = 0; i < 100000; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (i < 30000) data[i] = seed >> 24;
+        else if (i < 40000) data[i] = 0xAA;
+        else data[i] = "mov r0, #1; ldr r1, [r2]; "[i % 26];
+    }
+    u8 *packed = NULL;
+    size_t packed_len = png_deflate(data, sizeof(data), &packed);
+    size_t n = png_inflate(packed, packed_len, back, sizeof(back));
+    if (n != sizeof(data) || memcmp(data, back, n) != 0)
+        printf("FAIL: Inflate returned %zu of %zu bytes\n", n, sizeof(data));
+    else printf("PASS: Inflate restores %zu bytes from %zu\n", n, packed_len);
+
+    if (png_inflate(packed, packed_len / 2, back, sizeof(back)) != (size_t)-1)
+        printf("FAIL: Truncated stream accepted\n");
+    else printf("PASS: Truncated stream rejected\n");
+    free(packed);
+}
+
+int main() {
+    test_checksums();
+    test_stored_roundtrip();
+    test_fast_compresses();
+    test_raw_deflate();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "../include/cpu.h"
+#include "../include/memory.h"
+#include "../include/profiler.h"
+#include "../include/scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYMBOLS_PATH "test_profiler_syms.tmp"
+#define FOLDED_PATH "test_profiler_folded.tmp"
+
+void test_symbols() {
+    printf("Testing Symbol Loading...\n");
+    FILE *f = fopen(SYMBOLS_PATH, "w");
+    fprintf(f, " .text          0x02000000      0x300 main.o\n");
+    fprintf(f, "                0x02000000                main\n");
+    fprintf(f, "02000100 T update\n");
+    fprintf(f, "0x02000201 draw\n"); // Thumb bit is dropped
+    fclose(f);
+    bool ok = profiler_load_symbols(SYMBOLS_PATH);
+    remove(SYMBOLS_PATH);
+
+    const char *a = profiler_symbol(0x02000000);
+    const char *b = profiler_symbol(0x020001FE);
+    const char *c = profiler_symbol(0x02000210);
+    if (!ok || !a || strcmp(a, "main") || !b || strcmp(b, "update") || !c || strcmp(c, "draw"))
+        printf("FAIL: Symbol lookup main=%s update=%s draw=%s\n", a, b, c);
+    else printf("PASS: .map and nm lines resolve to the enclosing symbol\n");
+
+    if (profiler_symbol(0x01000000)) printf("FAIL: Address below all symbols resolved\n");
+    else printf("PASS: Address below all symbols is unresolved\n");
+}
+
+void test_call_stacks() {
+    printf("Testing Folded Call Stacks...\n");
+    scheduler_init();
+    memory_init();
+
+    // main: bl update; b main
+    bus_write32(0x02000000, 0xEB00003E);
+    bus_write32(0x02000004, 0xEAFFFFFD);
+    // update: push {lr}; bl draw; pop {pc}
+    bus_write32(0x02000100, 0xE92D4000);
+    bus_write32(0x02000104, 0xEB00003D);
+    bus_write32(0x02000108, 0xE8BD8000);
+    // draw: 64-iteration loop; bx lr
+    bus_write32(0x02000200, 0xE3A00040);
+    bus_write32(0x02000204, 0xE2500001);
+    bus_write32(0x02000208, 0x1AFFFFFD);
+    bus_write32(0x0200020C, 0xE12FFF1E);
+
+    ARM7TDMI cpu;
+    cpu_game_hacks = false; // Zaffiro workarounds would poke IWRAM/VRAM mid-run
+    cpu_init(&cpu);
+    cpu.r[REG_PC] = 0x02000000;
+    cpu.r[REG_SP] = 0x03007F00;
+    profiler_init(16);
+    for (int i = 0; i < 20000; i++) profiler_sample(&cpu, cpu_step(&cpu));
+    profiler_enabled = false;
+    profiler_write(FOLDED_PATH);
+
+    FILE *f = fopen(FOLDED_PATH, "r");
+    char line[256];
+    unsigned long long draw = 0, other = 0;
+    bool bad = false;
+    while (f && fgets(line, sizeof(line), f)) {
+        char *space = strrchr(line, ' ');
+        if (!space) continue;
+        unsigned long long n = strtoull(space + 1, NULL, 10);
+        *space = '\0';
+        if (strcmp(line, "root;update;draw") == 0) draw += n;
+        else if (strcmp(line, "root;main") == 0 || strcmp(line, "root;update") == 0) other += n;
+        else bad = true;
+    }
+    if (f) fclose(f);
+    remove(FOLDED_PATH);
+
+    if (bad || !draw || draw < other * 4)
+        printf("FAIL: Folded stacks draw=%llu other=%llu unexpected=%d\n", draw, other, bad);
+    else printf("PASS: BL/POP {PC}/BX LR tracking (draw %llu of %llu samples)\n", draw, draw + other);
+}
+
+int main() {
+    printf("Running Profiler Unit Tests...\n");
+    test_symbols();
+    test_call_stacks();
+    printf("Tests Complete.\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "../include/timer.h"
+#include "../include/apu.h"
+#include "../include/io.h"
+#include "../include/memory.h"
+#include "../include/scheduler.h"
+#include <string.h>
+
+typedef struct {
+  u16 reload;
+  u16 control;
+  u16 counter;     // Counter value at start_cycle
+  u64 start_cycle;
+} Timer;
+
+static Timer timers[4];
+
+// Prescaler: 0=1, 1=64, 2=256, 3=1024
+static const int prescaler_shift[4] = {0, 6, 8, 10};
+
+static inline bool timer_running(const Timer *t) { return t->control & 0x80; }
+
+// Counts cycles itself (running and not in count-up mode)
+static inline bool timer_ticking(int i) {
+  const Timer *t = &timers[i];
+  return timer_running(t) && !(i > 0 && (t->control & 0x04));
+}
+
+static void schedule_overflow(int i) {
+  Timer *t = &timers[i];
+  if (!timer_ticking(i)) {
+    scheduler_cancel(SCHED_TIMER0 + i);
+    return;
+  }
+  u64 ticks = 0x10000 - t->counter;
+  scheduler_schedule(SCHED_TIMER0 + i, t->start_cycle + (ticks << prescaler_shift[t->control & 3]));
+}
+
+u16 timer_read_counter(int i) {
+  Timer *t = &timers[i];
+  if (!timer_ticking(i)) return t->counter;
+  u64 elapsed = scheduler_now() - t->start_cycle;
+  return (u16)(t->counter + (elapsed >> prescaler_shift[t->control & 3]));
+}
+
+static void timer_overflow(int i, u64 when) {
+  Timer *t = &timers[i];
+  t->counter = t->reload;
+  t->start_cycle = when;
+  if (timer_ticking(i)) schedule_overflow(i);
+
+  if (t->control & 0x40) {
+    io_request_irq(1 << (3 + i));
+  }
+
+  // Timers 0/1 clock the Direct Sound FIFOs
+  if (i < 2) apu_timer_overflow(i);
+
+  // Count-up chain: the next timer ticks once per overflow
+  if (i < 3) {
+    Timer *next = &timers[i + 1];
+    if (timer_running(next) && (next->control & 0x04)) {
+      if (++next->counter == 0) timer_overflow(i + 1, when);
+    }
+  }
+}
+
+static void timer_event(SchedEvent event, u64 when) { timer_overflow(event - SCHED_TIMER0, when); }
+
+static void timer_write_control(int i, u16 value) {
+  Timer *t = &timers[i];
+  bool was_running = timer_running(t);
+
+  // Latch the current count before changing mode or prescaler
+  t->counter = timer_read_counter(i);
+  t->control = value & 0xC7;
+  if (!was_running && timer_running(t)) t->counter = t->reload;
+  t->start_cycle = scheduler_now();
+  schedule_overflow(i);
+}
+
+void timer_io_write(u32 offset, int size) {
+  u8 *io = memory_get_io();
+  for (int i = 0; i < 4; i++) {
+    u32 base = 0x100 + i * 4;
+    if (offset + size <= base || offset >= base + 4) continue;
+    // Reload is written before control, so a 32-bit write starts the
+    // timer with the new reload value
+    if (offset < base + 2) timers[i].reload = *(u16 *)&io[base];
+    if (offset + size > base + 2) timer_write_control(i, *(u16 *)&io[base + 2]);
+  }
+}
+
+void timer_init(void) {
+  memset(timers, 0, sizeof(timers));
+  for (int i = 0; i < 4; i++) scheduler_register(SCHED_TIMER0 + i, timer_event);
+}
@@ -0,0 +1,518 @@
+#include "../include/trace.h"
+#include "../include/memory.h"
+#include "../include/png.h"
+#include "../include/scheduler.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File layout: "GBATRACE" + u32 version, then blocks of
+//   u32 records, u32 raw size, u32 packed size, raw deflate data
+// Each block decodes on its own. Inside, a record is a header byte followed
+// by LEB128 varints, each field predicted from what came before in the
+// block: cycle delta, PC against the previous record's R15, the opcode
+// unless the per-PC opcode cache already holds it, CPSR when it changed, a
+// mask of registers that missed their prediction (the previous value; PC +
+// 2/4 for R15) and their zigzag deltas, then the data access (address
+// delta, value). Straight-line code costs a few bytes per record and loops
+// repeat byte for byte, which the LZ77 pass folds away.
+
+#define TRACE_MAGIC "GBATRACE"
+#define TRACE_VERSION 1
+
+// Header byte
+#define HEAD_TYPE 0x03
+#define HEAD_CPSR 0x04   // CPSR follows
+#define HEAD_CACHED 0x08 // Opcode comes from the cache
+#define HEAD_MEM_SHIFT 4 // 2 bits: no access, 8, 16, 32-bit
+#define HEAD_WRITE 0x40
+#define HEAD_THUMB 0x80
+
+#define OPCODE_CACHE 1024
+
+#define CHUNK_RECORDS 8192
+#define CHUNKS 4
+// Worst case per record: header, 10-byte cycle, 4 * 5 bytes of PC, opcode,
+// CPSR and access address, 3-byte mask, 16 registers and the value
+#define MAX_RECORD_BYTES (1 + 10 + 20 + 3 + 16 * 5 + 5)
+
+bool trace_enabled = false;
+
+// Prediction state, kept in step by the encoder and the decoder and reset
+// at every block
+typedef struct {
+  TraceRecord prev;
+  u32 last_mem;
+  u32 op_pc[OPCODE_CACHE];
+  u32 op_val[OPCODE_CACHE];
+} Codec;
+
+static inline u32 *cached_opcode(Codec *c, u32 pc, bool *hit) {
+  u32 i = (pc >> 1) & (OPCODE_CACHE - 1);
+  *hit = c->op_pc[i] == pc;
+  c->op_pc[i] = pc;
+  return &c->op_val[i];
+}
+
+static inline u32 predicted_r15(const TraceRecord *rec) {
+  return rec->pc + ((rec->flags & TRACE_THUMB) ? 2 : 4);
+}
+
+static const u8 mem_code[5] = {0, 1, 2, 0, 3};
+static const u8 mem_size[4] = {0, 1, 2, 4};
+
+typedef struct {
+  TraceRecord recs[CHUNK_RECORDS];
+  u32 count;
+} Chunk;
+
+// Filled chunks travel to the writer thread through a FIFO; it hands them
+// back on a free list. The emulation thread only blocks when all are full.
+typedef struct {
+  FILE *file;
+  const char *path;
+  Chunk *cur;
+  TraceRecord *pending; // Record of the instruction being stepped
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t filled;
+  pthread_cond_t freed;
+  Chunk *full[CHUNKS];
+  int full_head;
+  int full_count;
+  Chunk *free_list[CHUNKS];
+  int free_count;
+  bool closing;
+
+  u8 *raw; // Writer thread scratch
+  Codec codec;
+  u64 records;
+  u64 bytes;
+  bool failed;
+} TraceWriter;
+
+// One writer per emulation thread
+static _Thread_local TraceWriter *writer;
+
+// Varints
+
+static inline u8 *put_varint(u8 *p, u64 v) {
+  while (v >= 0x80) {
+    *p++ = (u8)v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (u8)v;
+  return p;
+}
+
+static inline u32 zigzag(u32 v) { return (v << 1) ^ (u32)((s32)v >> 31); }
+static inline u32 unzigzag(u32 v) { return (v >> 1) ^ (0u - (v & 1)); }
+
+static void put_le32(u8 *p, u32 v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static u32 get_le32(const u8 *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24); }
+
+// Encoding (writer thread)
+
+static size_t encode_chunk(const Chunk *chunk, Codec *c, u8 *out) {
+  memset(c, 0, sizeof(*c));
+  TraceRecord *prev = &c->prev;
+  u8 *p = out;
+  for (u32 i = 0; i < chunk->count; i++) {
+    const TraceRecord *rec = &chunk->recs[i];
+    bool hit;
+    u32 *op = cached_opcode(c, rec->pc, &hit);
+    hit = hit && *op == rec->opcode;
+    *op = rec->opcode;
+    u32 size = rec->flags & TRACE_MEM_SIZE;
+    bool cpsr_changed = rec->cpsr != prev->cpsr;
+
+    *p++ = rec->type | (cpsr_changed ? HEAD_CPSR : 0) | (hit ? HEAD_CACHED : 0) |
+           (mem_code[size] << HEAD_MEM_SHIFT) | ((rec->flags & TRACE_MEM_WRITE) ? HEAD_WRITE : 0) |
+           ((rec->flags & TRACE_THUMB) ? HEAD_THUMB : 0);
+    p = put_varint(p, rec->cycle - prev->cycle);
+    p = put_varint(p, zigzag(rec->pc - prev->r[REG_PC]));
+    if (!hit) p = put_varint(p, rec->opcode);
+    if (cpsr_changed) p = put_varint(p, rec->cpsr);
+
+    u32 ref[16];
+    memcpy(ref, prev->r, sizeof(ref));
+    ref[REG_PC] = predicted_r15(rec);
+    u32 mask = 0;
+    for (int r = 0; r < 16; r++) {
+      if (rec->r[r] != ref[r]) mask |= 1u << r;
+    }
+    p = put_varint(p, mask);
+    for (int r = 0; r < 16; r++) {
+      if (mask & (1u << r)) p = put_varint(p, zigzag(rec->r[r] - ref[r]));
+    }
+
+    if (size) {
+      p = put_varint(p, zigzag(rec->mem_addr - c->last_mem));
+      p = put_varint(p, rec->mem_value);
+      c->last_mem = rec->mem_addr;
+    }
+    *prev = *rec;
+  }
+  return (size_t)(p - out);
+}
+
+static void write_chunk(TraceWriter *w, const Chunk *c) {
+  size_t raw_len = encode_chunk(c, &w->codec, w->raw);
+  u8 *packed;
+  size_t packed_len = png_deflate(w->raw, raw_len, &packed);
+  if (!packed) {
+    w->failed = true;
+    return;
+  }
+  u8 head[12];
+  put_le32(head, c->count);
+  put_le32(head + 4, (u32)raw_len);
+  put_le32(head + 8, (u32)packed_len);
+  if (fwrite(head, 1, 12, w->file) != 12 || fwrite(packed, 1, packed_len, w->file) != packed_len)
+    w->failed = true;
+  free(packed);
+  w->records += c->count;
+  w->bytes += 12 + packed_len;
+}
+
+static void *writer_main(void *arg) {
+  TraceWriter *w = (TraceWriter *)arg;
+  for (;;) {
+    pthread_mutex_lock(&w->lock);
+    while (w->full_count == 0 && !w->closing) pthread_cond_wait(&w->filled, &w->lock);
+    if (w->full_count == 0) {
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    Chunk *c = w->full[w->full_head];
+    w->full_head = (w->full_head + 1) % CHUNKS;
+    w->full_count--;
+    pthread_mutex_unlock(&w->lock);
+
+    write_chunk(w, c);
+
+    pthread_mutex_lock(&w->lock);
+    c->count = 0;
+    w->free_list[w->free_count++] = c;
+    pthread_cond_signal(&w->freed);
+    pthread_mutex_unlock(&w->lock);
+  }
+  return NULL;
+}
+
+// Queue the current chunk and take a free one (waiting for the writer if
+// every chunk is in flight)
+static void submit_chunk(TraceWriter *w, bool take_next) {
+  pthread_mutex_lock(&w->lock);
+  w->full[(w->full_head + w->full_count) % CHUNKS] = w->cur;
+  w->full_count++;
+  pthread_cond_signal(&w->filled);
+  w->cur = NULL;
+  if (take_next) {
+    while (w->free_count == 0) pthread_cond_wait(&w->freed, &w->lock);
+    w->cur = w->free_list[--w->free_count];
+  }
+  pthread_mutex_unlock(&w->lock);
+}
+
+bool trace_open(const char *path) {
+  if (writer) trace_close();
+  TraceWriter *w = (TraceWriter *)calloc(1, sizeof(TraceWriter));
+  if (!w) return false;
+  w->raw = (u8 *)malloc((size_t)CHUNK_RECORDS * MAX_RECORD_BYTES);
+  for (int i = 0; i < CHUNKS; i++) {
+    Chunk *c = (Chunk *)calloc(1, sizeof(Chunk));
+    if (c) w->free_list[w->free_count++] = c;
+  }
+  w->file = fopen(path, "wb");
+  if (!w->file || !w->raw || w->free_count < CHUNKS) {
+    if (!w->file) printf("Failed to open trace file: %s\n", path);
+    else fclose(w->file);
+    for (int i = 0; i < w->free_count; i++) free(w->free_list[i]);
+    free(w->raw);
+    free(w);
+    return false;
+  }
+
+  u8 head[12];
+  memcpy(head, TRACE_MAGIC, 8);
+  put_le32(head + 8, TRACE_VERSION);
+  fwrite(head, 1, 12, w->file);
+  w->bytes = 12;
+  w->path = path;
+  w->cur = w->free_list[--w->free_count];
+
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->filled, NULL);
+  pthread_cond_init(&w->freed, NULL);
+  if (pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+    fclose(w->file);
+    for (int i = 0; i < w->free_count; i++) free(w->free_list[i]);
+    free(w->cur);
+    free(w->raw);
+    free(w);
+    return false;
+  }
+  writer = w;
+  trace_enabled = true;
+  return true;
+}
+
+void trace_close(void) {
+  TraceWriter *w = writer;
+  if (!w) return;
+  writer = NULL;
+  trace_enabled = false;
+
+  if (w->cur->count) submit_chunk(w, false);
+  pthread_mutex_lock(&w->lock);
+  w->closing = true;
+  pthread_cond_signal(&w->filled);
+  pthread_mutex_unlock(&w->lock);
+  pthread_join(w->thread, NULL);
+
+  if (fclose(w->file) != 0) w->failed = true;
+  if (w->failed) printf("[Trace] Write error on %s\n", w->path);
+  else
+    printf("[Trace] Wrote %llu records to %s (%llu bytes, %.2f bytes/record)\n",
+           (unsigned long long)w->records, w->path, (unsigned long long)w->bytes,
+           w->records ? (double)w->bytes / w->records : 0.0);
+
+  // Chunks are all back on the free list, plus the one in hand if unsent
+  for (int i = 0; i < w->free_count; i++) free(w->free_list[i]);
+  free(w->cur);
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->filled);
+  pthread_cond_destroy(&w->freed);
+  free(w->raw);
+  free(w);
+}
+
+// Capture (emulation thread)
+
+static inline TraceRecord *next_record(TraceWriter *w) { return &w->cur->recs[w->cur->count]; }
+
+static inline void emit(TraceWriter *w) {
+  if (++w->cur->count == CHUNK_RECORDS) submit_chunk(w, true);
+}
+
+// Opcode straight from memory: a bus fetch would bill cycles and move the
+// prefetcher
+static u32 peek_opcode(u32 pc, bool thumb) {
+  const u8 *p = memory_region_ptr(pc, thumb ? 2 : 4, false);
+  if (!p) return 0;
+  return thumb ? *(const u16 *)p : *(const u32 *)p;
+}
+
+void trace_begin(ARM7TDMI *cpu) {
+  TraceWriter *w = writer;
+  if (!w) return;
+  TraceRecord *rec = next_record(w);
+  bool thumb = (cpu->cpsr & FLAG_T) != 0;
+  rec->cycle = scheduler_now();
+  rec->pc = cpu->r[REG_PC];
+  rec->opcode = peek_opcode(rec->pc, thumb);
+  rec->type = TRACE_EXEC;
+  rec->flags = thumb ? TRACE_THUMB : 0;
+  rec->mem_addr = 0;
+  rec->mem_value = 0;
+  w->pending = rec;
+}
+
+void trace_mem(u32 addr, u32 value, u32 flags) {
+  TraceWriter *w = writer;
+  if (!w || !w->pending || (w->pending->flags & TRACE_MEM_SIZE)) return;
+  w->pending->mem_addr = addr;
+  w->pending->mem_value = value;
+  w->pending->flags |= flags;
+}
+
+void trace_end(ARM7TDMI *cpu) {
+  TraceWriter *w = writer;
+  if (!w || !w->pending) return;
+  memcpy(w->pending->r, cpu->r, sizeof(cpu->r));
+  w->pending->cpsr = cpu_get_cpsr(cpu);
+  w->pending = NULL;
+  emit(w);
+}
+
+void trace_event(ARM7TDMI *cpu, TraceEvent type, u32 pc, u32 arg) {
+  TraceWriter *w = writer;
+  if (!w || w->pending) return;
+  TraceRecord *rec = next_record(w);
+  rec->cycle = scheduler_now();
+  rec->pc = pc;
+  rec->opcode = arg;
+  rec->type = type;
+  rec->flags = 0;
+  rec->mem_addr = 0;
+  rec->mem_value = 0;
+  memcpy(rec->r, cpu->r, sizeof(cpu->r));
+  rec->cpsr = cpu_get_cpsr(cpu);
+  emit(w);
+}
+
+// Reading
+
+struct TraceReader {
+  FILE *file;
+  u8 *packed;
+  size_t packed_cap;
+  u8 *raw;
+  size_t raw_cap;
+  size_t raw_len;
+  size_t pos;
+  u32 left; // Records still to decode in the current block
+  Codec codec;
+};
+
+TraceReader *trace_reader_open(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    printf("Failed to open trace file: %s\n", path);
+    return NULL;
+  }
+  u8 head[12];
+  if (fread(head, 1, 12, f) != 12 || memcmp(head, TRACE_MAGIC, 8) != 0 ||
+      get_le32(head + 8) != TRACE_VERSION) {
+    printf("Not a version %d trace file: %s\n", TRACE_VERSION, path);
+    fclose(f);
+    return NULL;
+  }
+  TraceReader *r = (TraceReader *)calloc(1, sizeof(TraceReader));
+  if (!r) {
+    fclose(f);
+    return NULL;
+  }
+  r->file = f;
+  return r;
+}
+
+static bool grow(u8 **buf, size_t *cap, size_t need) {
+  if (need <= *cap) return true;
+  u8 *p = (u8 *)realloc(*buf, need);
+  if (!p) return false;
+  *buf = p;
+  *cap = need;
+  return true;
+}
+
+static bool read_block(TraceReader *r) {
+  u8 head[12];
+  if (fread(head, 1, 12, r->file) != 12) return false;
+  u32 count = get_le32(head);
+  size_t raw_len = get_le32(head + 4);
+  size_t packed_len = get_le32(head + 8);
+  if (!grow(&r->packed, &r->packed_cap, packed_len) || !grow(&r->raw, &r->raw_cap, raw_len)) return false;
+  if (fread(r->packed, 1, packed_len, r->file) != packed_len) return false;
+  if (png_inflate(r->packed, packed_len, r->raw, raw_len) != raw_len) return false;
+  r->raw_len = raw_len;
+  r->pos = 0;
+  r->left = count;
+  memset(&r->codec, 0, sizeof(r->codec));
+  return true;
+}
+
+static bool get_varint(TraceReader *r, u64 *v) {
+  u64 value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (r->pos >= r->raw_len) return false;
+    u8 b = r->raw[r->pos++];
+    value |= (u64)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *v = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool trace_reader_next(TraceReader *r, TraceRecord *rec) {
+  while (r->left == 0) {
+    if (!read_block(r)) return false;
+  }
+  if (r->pos >= r->raw_len) return false;
+  Codec *c = &r->codec;
+  TraceRecord *prev = &c->prev;
+  u8 head = r->raw[r->pos++];
+  u64 cycle, pc, opcode = 0, cpsr = prev->cpsr, mask;
+  if (!get_varint(r, &cycle) || !get_varint(r, &pc)) return false;
+  rec->type = head & HEAD_TYPE;
+  rec->flags = mem_size[(head >> HEAD_MEM_SHIFT) & 3] | ((head & HEAD_WRITE) ? TRACE_MEM_WRITE : 0) |
+               ((head & HEAD_THUMB) ? TRACE_THUMB : 0);
+  rec->cycle = prev->cycle + cycle;
+  rec->pc = prev->r[REG_PC] + unzigzag((u32)pc);
+
+  bool hit;
+  u32 *op = cached_opcode(c, rec->pc, &hit);
+  if (head & HEAD_CACHED) opcode = *op;
+  else if (!get_varint(r, &opcode)) return false;
+  *op = rec->opcode = (u32)opcode;
+  if ((head & HEAD_CPSR) && !get_varint(r, &cpsr)) return false;
+  rec->cpsr = (u32)cpsr;
+
+  if (!get_varint(r, &mask)) return false;
+  u32 ref[16];
+  memcpy(ref, prev->r, sizeof(ref));
+  ref[REG_PC] = predicted_r15(rec);
+  rec->changed = 0;
+  for (int i = 0; i < 16; i++) {
+    u64 delta = 0;
+    if ((mask & (1u << i)) && !get_varint(r, &delta)) return false;
+    rec->r[i] = ref[i] + unzigzag((u32)delta);
+    if (rec->r[i] != prev->r[i]) rec->changed |= 1u << i;
+  }
+
+  rec->mem_addr = 0;
+  rec->mem_value = 0;
+  if (rec->flags & TRACE_MEM_SIZE) {
+    u64 addr, value;
+    if (!get_varint(r, &addr) || !get_varint(r, &value)) return false;
+    rec->mem_addr = c->last_mem + unzigzag((u32)addr);
+    rec->mem_value = (u32)value;
+    c->last_mem = rec->mem_addr;
+  }
+  *prev = *rec;
+  r->left--;
+  return true;
+}
+
+void trace_reader_close(TraceReader *r) {
+  if (!r) return;
+  fclose(r->file);
+  free(r->packed);
+  free(r->raw);
+  free(r);
+}
+
+// Text Rendering
+
+static const char *event_names[TRACE_EVENTS] = {"exec", "irq", "halt"};
+
+void trace_format(const TraceRecord *rec, FILE *out) {
+  fprintf(out, "%12llu %-4s %08X ", (unsigned long long)rec->cycle,
+          rec->type < TRACE_EVENTS ? event_names[rec->type] : "?", rec->pc);
+  if (rec->type != TRACE_EXEC) fprintf(out, "%8X", rec->opcode);
+  else if (rec->flags & TRACE_THUMB) fprintf(out, "    %04X", rec->opcode);
+  else fprintf(out, "%08X", rec->opcode);
+
+  // PC moves on every step; only the other registers are worth listing
+  for (int i = 0; i < 15; i++) {
+    if (rec->changed & (1u << i)) fprintf(out, " r%d=%08X", i, rec->r[i]);
+  }
+  fprintf(out, " cpsr=%08X", rec->cpsr);
+
+  int size = rec->flags & TRACE_MEM_SIZE;
+  if (size) {
+    fprintf(out, " %s%d [%08X]=%0*X", (rec->flags & TRACE_MEM_WRITE) ? "st" : "ld", size * 8,
+            rec->mem_addr, size * 2, rec->mem_value);
+  }
+  fputc('\n', out);
+}
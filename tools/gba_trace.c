@@ -0,0 +1,88 @@
+// Trace viewer: decodes a --trace file and prints the records that pass
+// the filters, one line each.
+//
+//   ./gba_trace [--pc-min ADDR] [--pc-max ADDR] [--event exec|irq|halt]...
+//               [--limit N] [--summary] FILE
+//
+// Addresses are hex. --summary prints record counts per event instead.
+
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *event_names[TRACE_EVENTS] = {"exec", "irq", "halt"};
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] FILE\n", prog);
+  printf("  --pc-min ADDR   Skip records below ADDR (hex)\n");
+  printf("  --pc-max ADDR   Skip records above ADDR (hex)\n");
+  printf("  --event NAME    exec, irq or halt; repeat to keep several\n");
+  printf("  --limit N       Stop after N matching records\n");
+  printf("  --summary       Count matching records per event\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = NULL;
+  u32 pc_min = 0, pc_max = 0xFFFFFFFF;
+  u32 events = 0;
+  unsigned long long limit = 0;
+  bool summary = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--pc-min") == 0 && i + 1 < argc) {
+      pc_min = (u32)strtoul(argv[++i], NULL, 16);
+    } else if (strcmp(argv[i], "--pc-max") == 0 && i + 1 < argc) {
+      pc_max = (u32)strtoul(argv[++i], NULL, 16);
+    } else if (strcmp(argv[i], "--event") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      int e = 0;
+      while (e < TRACE_EVENTS && strcmp(name, event_names[e]) != 0) e++;
+      if (e == TRACE_EVENTS) {
+        printf("Unknown event: %s\n", name);
+        return 1;
+      }
+      events |= 1u << e;
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      limit = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--summary") == 0) {
+      summary = true;
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-' || path) {
+      print_usage(argv[0]);
+      return 1;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (!events) events = (1u << TRACE_EVENTS) - 1;
+
+  TraceReader *reader = trace_reader_open(path);
+  if (!reader) return 1;
+
+  TraceRecord rec;
+  unsigned long long total = 0, matched = 0;
+  unsigned long long counts[TRACE_EVENTS] = {0};
+  while (trace_reader_next(reader, &rec)) {
+    total++;
+    if (rec.pc < pc_min || rec.pc > pc_max || rec.type >= TRACE_EVENTS) continue;
+    if (!(events & (1u << rec.type))) continue;
+    matched++;
+    counts[rec.type]++;
+    if (!summary) trace_format(&rec, stdout);
+    if (limit && matched == limit) break;
+  }
+  trace_reader_close(reader);
+
+  if (summary) {
+    printf("%llu records, %llu matched\n", total, matched);
+    for (int e = 0; e < TRACE_EVENTS; e++) printf("  %-4s %llu\n", event_names[e], counts[e]);
+  }
+  return 0;
+}